@@ -0,0 +1,258 @@
+#include <iostream>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <map>
+#include "helpers.hpp"
+#include "implementation.hpp"
+
+// Benchmark of the alignment versions on generated sequences, without Slurm or input files.
+// Every configuration (version x size x threads x grain/tile value) is run --warmup times
+// untimed and --reps times timed; the fill, traceback and file output phases are timed apart.
+// Results go to stdout (or --out) as CSV or JSON, with GCUPS of the fill phase and the parallel
+// efficiency against the same configuration on one thread.
+
+struct BenchResult {
+    std::string version;
+    int size = 0, threads = 0, param = 0;
+    double fill = 0, traceback = 0, io = 0; // median seconds over the repetitions
+    double gcups = 0, efficiency = 0;
+    bool ok = true; // score matches the sequential version
+};
+
+// One timed run of a version, phases in seconds
+struct Phases {
+    double fill = 0, traceback = 0, io = 0;
+    float score = 0;
+};
+
+std::vector<int> parse_list(std::string arg) {
+    std::vector<int> res;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        res.push_back(std::stoi(item));
+    return res;
+}
+
+std::vector<std::string> parse_names(std::string arg) {
+    std::vector<std::string> res;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        res.push_back(item);
+    return res;
+}
+
+// Random X over the residues, and Y as X with about 10% substitutions and indels
+void generate(int size, unsigned seed, const std::string& residues, std::vector<char>& X, std::vector<char>& Y) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick(0, residues.size() - 1);
+    std::uniform_real_distribution<double> coin(0, 1);
+
+    X.clear();
+    Y.clear();
+    for (int i = 0; i < size; ++i)
+        X.push_back(residues[pick(rng)]);
+    for (int i = 0; (int)Y.size() < size; ++i) {
+        double r = coin(rng);
+        char c = X[i % size];
+        if (r < 0.05) Y.push_back(residues[pick(rng)]);
+        else if (r < 0.075) continue;
+        else if (r < 0.1) { Y.push_back(residues[pick(rng)]); Y.push_back(c); }
+        else Y.push_back(c);
+    }
+    Y.resize(size);
+}
+
+double seconds_since(std::chrono::high_resolution_clock::time_point t) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t).count();
+}
+
+// Runs a version once. param is the grain size or tile edge, depending on the version.
+Phases run_version(const std::string& version, SequenceInfo& sinfo, float** S, BlockedMatrix& B, float** SUB, std::unordered_map<char, int>& cmap, int threads, int param) {
+    Phases ph;
+    sinfo.reset();
+    omp_set_num_threads(threads);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    bool full_matrix = true;
+    DirectionMatrix D;
+
+    if (version == "sequential") sinfo.gpsa_sequential(S, SUB, cmap);
+    else if (version == "taskloop") sinfo.gpsa_taskloop(S, SUB, cmap, param);
+    else if (version == "tasks") sinfo.gpsa_tasks(S, SUB, cmap, param);
+    else if (version == "simd") sinfo.gpsa_simd(S, SUB, cmap);
+    else if (version == "striped") sinfo.gpsa_striped(S, SUB, cmap);
+    else if (version == "specialized") sinfo.gpsa_specialized(S, SUB, cmap);
+    else if (version == "tiled") sinfo.gpsa_tiled(S, SUB, cmap, param, param);
+    else if (version == "work-stealing") sinfo.gpsa_work_stealing(S, SUB, cmap, param, param, threads);
+    else {
+        full_matrix = false;
+        if (version == "hirschberg") sinfo.gpsa_hirschberg(SUB, cmap);
+        else if (version == "directions") sinfo.gpsa_directions(D, SUB, cmap);
+        else if (version == "blocked") sinfo.gpsa_blocked(B, SUB, cmap, param, param);
+        else if (version == "score-only") sinfo.gpsa_score_only(SUB, cmap, param, param);
+        else {
+            std::cerr << "[error]: unknown version '" << version << "'!" << std::endl;
+            exit(-1);
+        }
+    }
+    ph.fill = seconds_since(t0);
+
+    // traceback (hirschberg traces inside the fill, score-only has none)
+    t0 = std::chrono::high_resolution_clock::now();
+    if (full_matrix)
+        sinfo.traceback(S, SUB, cmap);
+    else if (version == "directions")
+        sinfo.traceback_directions(D, SUB, cmap);
+    else if (version == "blocked")
+        sinfo.traceback(B, SUB, cmap);
+    ph.traceback = seconds_since(t0);
+
+    ph.score = full_matrix ? S[sinfo.rows-1][sinfo.cols-1] : sinfo.alignment_score;
+
+    // output file
+    if (version != "score-only") {
+        t0 = std::chrono::high_resolution_clock::now();
+        sinfo.save_alignment("bench-aligned.txt");
+        ph.io = seconds_since(t0);
+    }
+
+    return ph;
+}
+
+double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[v.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+    // tasks is left out by default: with the default grain size it makes one task per cell
+    std::vector<std::string> versions = {"sequential", "taskloop", "simd", "striped", "specialized", "tiled", "work-stealing", "blocked", "hirschberg", "directions", "score-only"};
+    std::vector<int> sizes = {1024, 4096}, threads = {1, 2, 4}, grains = {1}, tiles = {64, 256};
+    int warmup = 1, reps = 3;
+    std::string format = "csv", out_filename = "", substitution_matrix_file = "blosum62.txt";
+    std::string usage("Usage: --versions <v1,v2,...> --sizes <n1,n2,...> --threads <t1,t2,...> --grain-sizes <g1,...> --tiles <t1,...> --warmup <n> --reps <n> --format <csv|json> --out <filename> --sub <matrix-filename|dna>\n"
+                      "Versions: sequential, taskloop, tasks, simd, striped, specialized, tiled, work-stealing, blocked, hirschberg, directions, score-only");
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--versions") versions = parse_names(argv[++i]);
+        else if (arg == "--sizes") sizes = parse_list(argv[++i]);
+        else if (arg == "--threads") threads = parse_list(argv[++i]);
+        else if (arg == "--grain-sizes") grains = parse_list(argv[++i]);
+        else if (arg == "--tiles") tiles = parse_list(argv[++i]);
+        else if (arg == "--warmup") warmup = std::stoi(argv[++i]);
+        else if (arg == "--reps") reps = std::stoi(argv[++i]);
+        else if (arg == "--format") format = argv[++i];
+        else if (arg == "--out") out_filename = argv[++i];
+        else if (arg == "--sub") substitution_matrix_file = argv[++i];
+        else {
+            std::cout << usage << std::endl;
+            exit(-1);
+        }
+    }
+    if (std::any_of(tiles.begin(), tiles.end(), [](int t) { return t < 1; })) {
+        std::cerr << "[error]: tile sizes must be at least 1!" << std::endl;
+        exit(-1);
+    }
+
+    SequenceInfo sinfo;
+    std::unordered_map<char, int> cmap;
+    // "dna" scores ACGT with match 1, mismatch -1 and gap -2 instead of reading a matrix
+    std::string residues = "ARNDCQEGHILKMFPSTWYV";
+    float** SUB;
+    if (substitution_matrix_file == "dna") {
+        SUB = sinfo.substitution_matrix_from_scheme(1, -1, -2, "ACGT", cmap);
+        residues = "ACGT";
+    }
+    else
+        SUB = sinfo.substitution_matrix_from_file(substitution_matrix_file, cmap);
+    std::vector<BenchResult> results;
+
+    for (int size: sizes) {
+        std::vector<char> X, Y;
+        generate(size, size, residues, X, Y);
+        sinfo.set_sequences(X, Y);
+        float** S = allocate(sinfo.rows, sinfo.cols, 0);
+        BlockedMatrix B;
+
+        // reference score
+        Phases ref = run_version("sequential", sinfo, S, B, SUB, cmap, 1, 1);
+
+        for (auto& version: versions) {
+            // which parameter the version sweeps
+            std::vector<int> params = {0};
+            if (version == "taskloop" || version == "tasks") params = grains;
+            else if (version == "tiled" || version == "work-stealing" || version == "blocked" || version == "score-only") params = tiles;
+
+            bool parallel = version != "sequential" && version != "simd" && version != "striped" && version != "specialized" && version != "directions";
+
+            for (int param: params) {
+                for (int t: threads) {
+                    if (!parallel && t != threads.front()) continue;
+
+                    std::vector<double> fill, traceback, io;
+                    bool ok = true;
+                    for (int r = 0; r < warmup + reps; ++r) {
+                        Phases ph = run_version(version, sinfo, S, B, SUB, cmap, t, param);
+                        ok = ok && ph.score == ref.score;
+                        if (r < warmup) continue;
+                        fill.push_back(ph.fill);
+                        traceback.push_back(ph.traceback);
+                        io.push_back(ph.io);
+                    }
+
+                    BenchResult res;
+                    res.version = version;
+                    res.size = size;
+                    res.threads = t;
+                    res.param = param;
+                    res.fill = median(fill);
+                    res.traceback = median(traceback);
+                    res.io = median(io);
+                    res.gcups = gcups(sinfo.rows, sinfo.cols, res.fill);
+                    res.ok = ok;
+                    results.push_back(res);
+                    std::cerr << "[bench]: " << version << " size=" << size << " threads=" << t << " param=" << param << " fill=" << res.fill << "s" << (ok ? "" : " NOT OK") << std::endl;
+                }
+            }
+        }
+        deallocate(S);
+    }
+    deallocate(SUB);
+
+    // parallel efficiency against one thread of the same configuration
+    std::map<std::tuple<std::string, int, int>, double> single;
+    for (auto& r: results)
+        if (r.threads == 1)
+            single[{r.version, r.size, r.param}] = r.fill;
+    for (auto& r: results) {
+        auto it = single.find({r.version, r.size, r.param});
+        r.efficiency = it == single.end() ? 0 : it->second / (r.fill * r.threads);
+    }
+
+    std::ofstream ofs;
+    if (!out_filename.empty()) ofs.open(out_filename, std::ofstream::trunc);
+    std::ostream& os = out_filename.empty() ? std::cout : ofs;
+
+    if (format == "json") {
+        os << "[" << std::endl;
+        for (unsigned int k = 0; k < results.size(); ++k) {
+            auto& r = results[k];
+            os << "  {\"version\": \"" << r.version << "\", \"size\": " << r.size << ", \"threads\": " << r.threads << ", \"param\": " << r.param
+               << ", \"fill_s\": " << r.fill << ", \"traceback_s\": " << r.traceback << ", \"io_s\": " << r.io
+               << ", \"gcups\": " << r.gcups << ", \"efficiency\": " << r.efficiency << ", \"ok\": " << (r.ok ? "true" : "false") << "}"
+               << (k + 1 < results.size() ? "," : "") << std::endl;
+        }
+        os << "]" << std::endl;
+    } else {
+        os << "version,size,threads,param,fill_s,traceback_s,io_s,gcups,efficiency,ok" << std::endl;
+        for (auto& r: results)
+            os << r.version << "," << r.size << "," << r.threads << "," << r.param << "," << r.fill << "," << r.traceback << "," << r.io << "," << r.gcups << "," << r.efficiency << "," << (r.ok ? 1 : 0) << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include <vector>
+#include <string_view>
+#include <span>
+#include <memory>
+#include <mutex>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+#include <array>
+#include <string>
+#include <stdexcept>
+
+#ifndef ENGINE
+#define ENGINE
+
+// Library interface for many alignments in one process. An AlignmentEngine holds the scoring and
+// a workspace that only grows: the score matrix, a row buffer and the aligned sequence buffers.
+// Every cell the fill reads is written first in the same call, so the workspace is never cleared,
+// and once it has grown to the largest pair no call allocates. Sequences come in encoded
+// (indices into the substitution matrix), results go out by value.
+// An engine is not thread safe; use one per thread, or lease them from an EnginePool.
+
+struct AlignmentResult {
+    float score = 0;
+    int similarity_score = 0, identity_score = 0, gap_count = 0;
+    unsigned long cells = 0; // cells computed
+    // aligned sequences, views into the engine's workspace, valid until its next align();
+    // empty for score only calls
+    std::string_view X_aligned, Y_aligned;
+};
+
+class AlignmentEngine {
+public:
+    AlignmentEngine(float** SUB, int sub_size, const std::unordered_map<char, int>& cmap) : sub_size(sub_size) {
+        sub.assign(SUB[0], SUB[0] + sub_size * sub_size);
+        gap = SUB[0][cmap.at('*')];
+        letters.assign(sub_size, '?');
+        codes.fill(-1);
+        for (auto& [c, k] : cmap) {
+            letters[k] = c;
+            codes[(unsigned char)c] = k;
+        }
+    }
+
+    // Encode a sequence into out, reusing its capacity. -1 marks a residue the matrix does not
+    // have, then the result is false.
+    bool encode(std::string_view seq, std::vector<int>& out) const {
+        out.resize(seq.size());
+        bool known = true;
+        for (size_t k = 0; k < seq.size(); ++k) {
+            out[k] = codes[(unsigned char)seq[k]];
+            known &= out[k] >= 0;
+        }
+        return known;
+    }
+
+    // Encode a sequence once, outside the hot path. Throws std::out_of_range (like cmap.at) for a
+    // residue the matrix does not have.
+    std::vector<int> encode(const std::vector<char>& seq) const {
+        std::vector<int> res;
+        if (!encode(std::string_view(seq.data(), seq.size()), res)) {
+            size_t k = std::find(res.begin(), res.end(), -1) - res.begin();
+            throw std::out_of_range(std::string("residue '") + seq[k] + "' is not in the substitution matrix");
+        }
+        return res;
+    }
+
+    // Global alignment of x against y, with the traceback of SequenceInfo::traceback_and_save
+    // (diagonal, up, left) unless with_traceback is false, then only the score in linear space.
+    AlignmentResult align(std::span<const int> x, std::span<const int> y, bool with_traceback = true) {
+        AlignmentResult res;
+        int rows = x.size() + 1, cols = y.size() + 1;
+        grow(T, cols);
+        res.cells = (unsigned long)rows * cols;
+
+        if (!with_traceback) {
+            grow(R, cols);
+            for (int j = 0; j < cols; ++j)
+                R[j] = j * gap;
+            for (int i = 1; i < rows; ++i)
+                fill_row(R.data(), R.data(), i * gap, x[i - 1], y, cols);
+            res.score = R[cols - 1];
+            return res;
+        }
+
+        grow(S, (size_t)rows * cols);
+        float* M = S.data();
+        for (int j = 0; j < cols; ++j)
+            M[j] = j * gap;
+        for (int i = 1; i < rows; ++i)
+            fill_row(M + (size_t)(i - 1) * cols, M + (size_t)i * cols, i * gap, x[i - 1], y, cols);
+        res.score = M[(size_t)rows * cols - 1];
+
+        traceback(M, x, y, rows, cols, res);
+        return res;
+    }
+
+    // bytes held by the workspace
+    size_t workspace_bytes() const {
+        return (S.capacity() + R.capacity() + T.capacity()) * sizeof(float) + X_buf.capacity() + Y_buf.capacity();
+    }
+
+private:
+    std::vector<float> sub;
+    int sub_size;
+    float gap;
+    std::vector<char> letters;
+    std::array<int, 256> codes;
+
+    // workspace
+    std::vector<float> S, R, T;
+    std::vector<char> X_buf, Y_buf;
+
+    template <typename V>
+    static void grow(V& v, size_t n) {
+        if (v.size() < n) v.resize(n);
+    }
+
+    // One row from the row above (up and cur may be the same buffer): diagonal and up moves
+    // first, vectorized, then the left moves in a scan
+    void fill_row(const float* up, float* cur, float first, int xi, std::span<const int> y, int cols) {
+        const float* sub_row = sub.data() + xi * sub_size;
+        float* t = T.data();
+#pragma omp simd
+        for (int j = 1; j < cols; ++j)
+            t[j] = std::max(up[j - 1] + sub_row[y[j - 1]], up[j] + gap);
+
+        float west = first;
+        cur[0] = first;
+        for (int j = 1; j < cols; ++j) {
+            west = std::max(t[j], west + gap);
+            cur[j] = west;
+        }
+    }
+
+    // Written backwards from the end of the buffers, so no reverse at the end
+    void traceback(const float* M, std::span<const int> x, std::span<const int> y, int rows, int cols, AlignmentResult& res) {
+        size_t cap = rows + cols;
+        grow(X_buf, cap);
+        grow(Y_buf, cap);
+        size_t pos = cap;
+        int i = rows - 1, j = cols - 1;
+
+        while (i > 0 || j > 0) {
+            float s = M[(size_t)i * cols + j];
+            if (i > 0 && j > 0 && s == M[(size_t)(i - 1) * cols + j - 1] + sub[x[i - 1] * sub_size + y[j - 1]]) {
+                --pos;
+                X_buf[pos] = letters[x[i - 1]];
+                Y_buf[pos] = letters[y[j - 1]];
+                if (sub[x[i - 1] * sub_size + y[j - 1]] > 0) {
+                    res.similarity_score++;
+                    if (x[i - 1] == y[j - 1])
+                        res.identity_score++;
+                }
+                i--; j--;
+            } else if (i > 0 && s == M[(size_t)(i - 1) * cols + j] + gap) {
+                --pos;
+                X_buf[pos] = letters[x[i - 1]];
+                Y_buf[pos] = '-';
+                res.gap_count++;
+                i--;
+            } else {
+                if (j <= 0) break;
+                --pos;
+                X_buf[pos] = '-';
+                Y_buf[pos] = letters[y[j - 1]];
+                res.gap_count++;
+                j--;
+            }
+        }
+
+        res.X_aligned = std::string_view(X_buf.data() + pos, cap - pos);
+        res.Y_aligned = std::string_view(Y_buf.data() + pos, cap - pos);
+    }
+};
+
+// Engines with warm workspaces for concurrent callers. lease() hands out an idle engine (making
+// one the first time), and the lease gives it back when it goes out of scope. The pool keeps its
+// own copy of cmap, SUB has to stay allocated as long as lease() may make engines.
+class EnginePool {
+public:
+    EnginePool(float** SUB, int sub_size, const std::unordered_map<char, int>& cmap) : SUB(SUB), sub_size(sub_size), cmap(cmap) {}
+
+    class Lease {
+    public:
+        Lease(EnginePool& pool, std::unique_ptr<AlignmentEngine> engine) : pool(pool), engine(std::move(engine)) {}
+        Lease(Lease&& other) = default;
+        ~Lease() { if (engine) pool.give_back(std::move(engine)); }
+        AlignmentEngine* operator->() { return engine.get(); }
+        AlignmentEngine& operator*() { return *engine; }
+
+    private:
+        EnginePool& pool;
+        std::unique_ptr<AlignmentEngine> engine;
+    };
+
+    Lease lease() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle.empty())
+            return Lease(*this, std::make_unique<AlignmentEngine>(SUB, sub_size, cmap));
+        auto engine = std::move(idle.back());
+        idle.pop_back();
+        return Lease(*this, std::move(engine));
+    }
+
+private:
+    float** SUB;
+    int sub_size;
+    std::unordered_map<char, int> cmap;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<AlignmentEngine>> idle;
+
+    void give_back(std::unique_ptr<AlignmentEngine> engine) {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(std::move(engine));
+    }
+};
+#endif
@@ -0,0 +1,163 @@
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <cstring>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifndef FASTA
+#define FASTA
+
+// One record of a multi-record FASTA file
+struct FastaRecord {
+    std::string name; // first word of the header
+    std::vector<char> seq;
+    std::vector<int> codes; // seq encoded as indices in the substitution matrix, if a cmap was given
+};
+
+// Streams the records of a FASTA file through a read-only memory mapping. Each line is scanned
+// once: residues go straight from the mapping into the record, encoded with a 256 entry table
+// on the way, and whitespace (including '\r') is dropped. With AVX2 the table is read eight
+// residues at a time by a gather, and runs without whitespace are copied in blocks. Records are
+// produced on demand by next(), which reuses the buffers of the record it is given. The residues
+// are copied rather than viewed in the mapping: line breaks split them, and streamed records
+// outlive the part of the file they came from.
+class FastaReader {
+    std::string filename;
+    const char *data = nullptr, *pos = nullptr, *end = nullptr;
+    size_t size = 0;
+    int table[256];
+    bool encode = false;
+
+public:
+    static const int SKIP = -1, UNKNOWN = -2;
+
+    FastaReader(std::string filename, const std::unordered_map<char, int>* cmap = nullptr) : filename(filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            std::cerr << "[error]: could not open input file '" << filename << "'!" << std::endl;
+            exit(-1);
+        }
+
+        size = st.st_size;
+        if (size > 0) {
+            void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                std::cerr << "[error]: could not map input file '" << filename << "'!" << std::endl;
+                exit(-1);
+            }
+            madvise(p, size, MADV_SEQUENTIAL);
+            data = (const char*)p;
+        }
+        close(fd);
+        pos = data;
+        end = data + size;
+
+        // without a cmap every residue is accepted, code 0 keeps it on the block path
+        encode = cmap != nullptr;
+        for (int c = 0; c < 256; ++c)
+            table[c] = encode ? UNKNOWN : 0;
+        if (cmap)
+            for (auto& kv: *cmap)
+                table[(unsigned char)kv.first] = kv.second;
+        for (char c: std::string(" \t\r\v\f"))
+            table[(unsigned char)c] = SKIP;
+    }
+
+    ~FastaReader() {
+        if (data) munmap((void*)data, size);
+    }
+
+    FastaReader(const FastaReader&) = delete;
+    FastaReader& operator=(const FastaReader&) = delete;
+
+    // Next record, false at the end of the file
+    bool next(FastaRecord& rec) {
+        rec.name.clear();
+        rec.seq.clear();
+        rec.codes.clear();
+
+        if (pos >= end)
+            return false;
+
+        // header, optional for the first record
+        if (*pos == '>') {
+            const char* eol = line_end(pos);
+            const char* p = pos + 1;
+            while (p < eol && !std::isspace((unsigned char)*p)) ++p;
+            rec.name.assign(pos + 1, p);
+            pos = eol < end ? eol + 1 : end;
+        }
+
+        while (pos < end && *pos != '>') {
+            const char* eol = line_end(pos);
+            size_t n = rec.seq.size();
+            rec.seq.resize(n + (eol - pos));
+            if (encode) rec.codes.resize(n + (eol - pos));
+
+            char* out = rec.seq.data() + n;
+            int* codes = encode ? rec.codes.data() + n : nullptr;
+            for (const char* p = pos; p < eol; ++p) {
+                p = copy_run(p, eol, out, codes);
+                if (p == eol) break;
+                int code = table[(unsigned char)*p];
+                if (code == SKIP) continue;
+                if (code == UNKNOWN && encode) {
+                    std::cerr << "[error]: unknown residue '" << *p << "' in '" << filename << "'!" << std::endl;
+                    exit(-1);
+                }
+                *out++ = *p;
+                if (codes) *codes++ = code;
+            }
+            rec.seq.resize(out - rec.seq.data());
+            if (encode) rec.codes.resize(rec.seq.size());
+
+            pos = eol < end ? eol + 1 : end;
+        }
+        return true;
+    }
+
+private:
+    // Copies and encodes residues from p on while they come in blocks of eight known residues,
+    // returns where the block path stopped
+    const char* copy_run(const char* p, [[maybe_unused]] const char* eol, [[maybe_unused]] char*& out, [[maybe_unused]] int*& codes) const {
+#if defined(__AVX2__)
+        for (; eol - p >= 8; p += 8) {
+            __m256i c = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p)), 4);
+            // SKIP and UNKNOWN are negative
+            if (_mm256_movemask_ps(_mm256_castsi256_ps(c))) break;
+            memcpy(out, p, 8);
+            out += 8;
+            if (codes) {
+                _mm256_storeu_si256((__m256i*)codes, c);
+                codes += 8;
+            }
+        }
+#endif
+        return p;
+    }
+
+    const char* line_end(const char* p) const {
+        const char* eol = (const char*)memchr(p, '\n', end - p);
+        return eol ? eol : end;
+    }
+};
+
+// Load every record of a FASTA file, and encode it with cmap
+std::vector<FastaRecord> load_fasta(std::string filename, std::unordered_map<char, int>& cmap) {
+    FastaReader reader(filename, &cmap);
+    std::vector<FastaRecord> records;
+    FastaRecord rec;
+    while (reader.next(rec))
+        records.push_back(rec);
+    return records;
+}
+#endif
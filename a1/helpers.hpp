@@ -7,10 +7,17 @@
 #include <iomanip>
 #include <map>
 #include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <cctype>
 
 #ifndef HELPERS
 #define HELPERS
 
+#include "fasta.hpp"
+#include "numa.hpp"
+
 // data allocation, contiguous
 float** allocate(unsigned int height, unsigned int width, const float& val = 0) {    
     float** ptr = new float*[height]; 
@@ -27,42 +34,251 @@ void deallocate(float** data) {
    delete [] data;     
 }
 
+// Move taken into every cell of S, 2 bits per cell (4 cells per byte), rows padded to whole bytes
+struct DirectionMatrix {
+    enum { DIAG = 0, UP = 1, LEFT = 2 };
+
+    int rows = 0, cols = 0, stride = 0;
+    std::vector<uint8_t> bits;
+
+    void resize(int rows, int cols) {
+        this->rows = rows;
+        this->cols = cols;
+        stride = (cols + 3) / 4;
+        bits.resize((size_t)rows * stride);
+    }
+
+    uint8_t* row(int i) { return &bits[(size_t)i * stride]; }
+
+    int get(int i, int j) const {
+        return (bits[(size_t)i * stride + j / 4] >> (2 * (j % 4))) & 3;
+    }
+};
+
+// Banded storage of S: row i holds columns lo[i]..hi[i], cells outside the band read as -inf
+struct BandedMatrix {
+    std::vector<int> lo, hi;
+    std::vector<size_t> offset;
+    std::vector<float> data;
+
+    void clear() {
+        lo.clear(); hi.clear(); offset.clear(); data.clear();
+    }
+
+    // append the next row, returns its storage indexed by j - lo
+    float* add_row(int row_lo, int row_hi) {
+        offset.push_back(data.size());
+        lo.push_back(row_lo);
+        hi.push_back(row_hi);
+        data.resize(data.size() + std::max(0, row_hi - row_lo + 1));
+        return data.data() + offset.back();
+    }
+
+    float get(int i, int j) const {
+        if (j < lo[i] || j > hi[i]) return -std::numeric_limits<float>::infinity();
+        return data[offset[i] + j - lo[i]];
+    }
+};
+
+// Tile-major storage of S. Tile (ti, tj) holds rows 1 + ti * tile_rows .. and columns
+// 1 + tj * tile_cols .. of the inner matrix, and is stored contiguously together with its halo
+// (the row above and the column to the left, copied from the neighbours) as a
+// (tile_rows + 1) x (tile_cols + 1) block, so filling a tile touches only that block.
+// Row 0 and column 0 of S live in the halos of the first tile row and column.
+// Only gpsa_blocked fills it, and traceback_and_save reads it through cell(). The other versions
+// keep the row-pointer S (float**): their kernels walk whole rows, strips or diagonals of it.
+struct BlockedMatrix {
+    int rows = 0, cols = 0, tile_rows = 0, tile_cols = 0, n_tr = 0, n_tc = 0, stride = 0;
+    std::vector<float> data;
+
+    void resize(int rows, int cols, int tile_rows, int tile_cols) {
+        this->rows = rows;
+        this->cols = cols;
+        this->tile_rows = tile_rows;
+        this->tile_cols = tile_cols;
+        n_tr = (rows - 2) / tile_rows + 1;
+        n_tc = (cols - 2) / tile_cols + 1;
+        stride = tile_cols + 1;
+        data.assign((size_t)n_tr * n_tc * (tile_rows + 1) * stride, 0);
+    }
+
+    float* tile(int ti, int tj) { return &data[((size_t)ti * n_tc + tj) * (tile_rows + 1) * stride]; }
+    const float* tile(int ti, int tj) const { return &data[((size_t)ti * n_tc + tj) * (tile_rows + 1) * stride]; }
+
+    // S[i][j], from the tile that computes it (row 0 and column 0 from a halo)
+    float& at(int i, int j) {
+        int ti = i > 0 ? (i - 1) / tile_rows : 0, tj = j > 0 ? (j - 1) / tile_cols : 0;
+        return tile(ti, tj)[(i - ti * tile_rows) * stride + j - tj * tile_cols];
+    }
+
+    float get(int i, int j) const {
+        int ti = i > 0 ? (i - 1) / tile_rows : 0, tj = j > 0 ? (j - 1) / tile_cols : 0;
+        return tile(ti, tj)[(i - ti * tile_rows) * stride + j - tj * tile_cols];
+    }
+};
+
+// Affine gap matrices (Gotoh) for one cell: best score ending in any move (H), in a left move
+// / gap in X (E) and in an up move / gap in Y (F). The three are interleaved, so the cell is read
+// and written with one access.
+struct AffineCell {
+    float H, E, F;
+};
+
+struct AffineMatrix {
+    int rows = 0, cols = 0;
+    std::vector<AffineCell> data;
+
+    // every cell is written by the fill, so growing does not clear
+    void resize(int rows, int cols) {
+        this->rows = rows;
+        this->cols = cols;
+        data.resize((size_t)rows * cols);
+    }
+
+    AffineCell* row(int i) { return &data[(size_t)i * cols]; }
+    const AffineCell& get(int i, int j) const { return data[(size_t)i * cols + j]; }
+};
+
+// Outcome of a banded run
+struct BandStatus {
+    int width = 0;               // band width used (0 for x-drop without a band)
+    bool reached_end = false;    // the bottom-right cell was computed
+    bool touched_edge = false;   // the traceback path runs next to a cell outside the band
+    bool proven_optimal = false; // no path leaving the band can beat the banded score
+};
+
+// Statistics of one aligned pair in batch mode
+struct PairResult {
+    int query = 0, target = 0; // record indices
+    float score = 0;
+    int similarity_score = 0, identity_score = 0, gap_count = 0, length = 0;
+};
+
+// Pairs listed in a file, one "<query-name> <target-name>" per line
+std::vector<std::pair<int, int>> load_pairs(std::string filename, const std::vector<FastaRecord>& queries, const std::vector<FastaRecord>& targets) {
+    std::unordered_map<std::string, int> qidx, tidx;
+    for (unsigned int i = 0; i < queries.size(); ++i) qidx[queries[i].name] = i;
+    for (unsigned int i = 0; i < targets.size(); ++i) tidx[targets[i].name] = i;
+
+    std::ifstream ifs(filename);
+    if (!ifs.good()) {
+        std::cerr << "[error]: could not open input file '" << filename << "'!" << std::endl;
+        exit(-1);
+    }
+
+    std::vector<std::pair<int, int>> pairs;
+    std::string q, t;
+    while (ifs >> q >> t) {
+        if (!qidx.count(q) || !tidx.count(t)) {
+            std::cerr << "[error]: unknown pair '" << q << " " << t << "' in '" << filename << "'!" << std::endl;
+            exit(-1);
+        }
+        pairs.emplace_back(qidx[q], tidx[t]);
+    }
+    return pairs;
+}
+
+// Cell access for traceback_and_save
+inline float cell(float** S, int i, int j) { return S[i][j]; }
+inline float cell(const BandedMatrix& S, int i, int j) { return S.get(i, j); }
+inline float cell(const BlockedMatrix& S, int i, int j) { return S.get(i, j); }
+
 struct SequenceInfo {
     std::vector<char> X, Y; // input sequences
     float match_score = 1.0, mismatch_score = -1.0, gap_penalty = -2.0; // default scoring scheme
     std::vector<char> X_aligned, Y_aligned; // aligned sequences
+    std::vector<int> X_codes, Y_codes; // sequences encoded as indices in the substitution matrix
 
     
     int rows=0, cols=0, SUB_size=0;// helpers
     int similarity_score = 0, identity_score = 0, gap_count = 0; // output statistics
+    float alignment_score = 0; // score of the alignment, for modes that do not keep S
+    int score_bits = 0; // integer width used by the striped kernel (16 or 32)
+    BandStatus band_status; // outcome of the banded version
+    std::string scoring_kernel; // scoring used by the specialized version (blosum62, dna or runtime)
 
     // interfaces
     unsigned long gpsa_sequential(float** s, float** SUB, std::unordered_map<char, int>& cmap);
     unsigned long gpsa_taskloop(float** s, float** SUB, std::unordered_map<char, int> cmap, int grain_size);
     unsigned long gpsa_tasks(float** s, float** SUB, std::unordered_map<char, int> cmap, int grain_size);
+    unsigned long gpsa_hirschberg(float** SUB, std::unordered_map<char, int>& cmap);
+    unsigned long gpsa_simd(float** S, float** SUB, std::unordered_map<char, int>& cmap);
+    unsigned long gpsa_striped(float** S, float** SUB, std::unordered_map<char, int>& cmap);
+    unsigned long gpsa_tiled(float** S, float** SUB, std::unordered_map<char, int>& cmap, int tile_rows, int tile_cols);
+    unsigned long gpsa_work_stealing(float** S, float** SUB, std::unordered_map<char, int>& cmap, int tile_rows, int tile_cols, int n_threads, const NumaLayout* layout = nullptr);
+    unsigned long gpsa_directions(DirectionMatrix& D, float** SUB, std::unordered_map<char, int>& cmap);
+    unsigned long gpsa_score_only(float** SUB, std::unordered_map<char, int>& cmap, int tile_rows, int tile_cols);
+    unsigned long gpsa_banded(BandedMatrix& B, float** SUB, std::unordered_map<char, int>& cmap, int band_width, float x_drop);
+    unsigned long gpsa_incremental(float** S, float** SUB, std::unordered_map<char, int>& cmap, int first_row, int first_col);
+    unsigned long gpsa_specialized(float** S, float** SUB, std::unordered_map<char, int>& cmap);
+    unsigned long gpsa_affine(AffineMatrix& A, float** SUB, std::unordered_map<char, int>& cmap, float gap_open, float gap_extend);
+    unsigned long gpsa_affine_tiled(AffineMatrix& A, float** SUB, std::unordered_map<char, int>& cmap, float gap_open, float gap_extend, int tile_rows, int tile_cols);
+    unsigned long gpsa_affine_simd(AffineMatrix& A, float** SUB, std::unordered_map<char, int>& cmap, float gap_open, float gap_extend);
+    unsigned long gpsa_blocked(BlockedMatrix& B, float** SUB, std::unordered_map<char, int>& cmap, int tile_rows, int tile_cols);
+
+    SequenceInfo() {
+        scoring_scheme(1.0, -1.0, -2.0);
+    }
 
     SequenceInfo(std::string X_filename, std::string Y_filename) {
-        X = load_sequence(X_filename);
-        Y = load_sequence(Y_filename);
+        set_sequences(load_sequence(X_filename), load_sequence(Y_filename));
+
+        scoring_scheme(1.0, -1.0, -2.0);
+    }
+
+    // Input sequences from memory
+    void set_sequences(std::vector<char> X, std::vector<char> Y) {
+        this->X = X;
+        this->Y = Y;
         rows = X.size()+1;
         cols = Y.size()+1;
+    }
 
-        scoring_scheme(1.0, -1.0, -2.0);
+    // Replace the sequences by revised ones, for gpsa_incremental. first_row / first_col are the
+    // first row and column of S that change: one past the longest common prefix of the old and
+    // new X (Y), or rows (cols) when that side did not change within the new length.
+    void revise_sequences(std::vector<char> X_new, std::vector<char> Y_new, int& first_row, int& first_col) {
+        auto common_prefix = [](const std::vector<char>& a, const std::vector<char>& b) {
+            size_t k = 0;
+            while (k < a.size() && k < b.size() && a[k] == b[k]) k++;
+            return (int)k;
+        };
+        first_row = common_prefix(X, X_new) + 1;
+        first_col = common_prefix(Y, Y_new) + 1;
+        set_sequences(X_new, Y_new);
     }
 
-    // Traceback, and write aligned sequences
-    void traceback_and_save(std::string filename, float** S, float** SUB, std::unordered_map<char, int> cmap, bool print=false) {
+    // Traceback, and write aligned sequences (S is float** or any matrix with a cell() overload)
+    template <typename Matrix>
+    void traceback_and_save(std::string filename, const Matrix& S, float** SUB, std::unordered_map<char, int> cmap, bool print=false) {
         std::remove(filename.c_str());
 
-        int i = X.size();
-        int j = Y.size();
+        traceback(S, SUB, cmap);
+        save_alignment(filename, print);
+    }
+
+    // Traceback only, fills the aligned sequences and the statistics
+    template <typename Matrix>
+    void traceback(const Matrix& S, float** SUB, std::unordered_map<char, int>& cmap) {
+        traceback_segment(S, SUB, cmap, X.size(), Y.size(), -1);
+
+        // built backwards
+        std::reverse(X_aligned.begin(), X_aligned.end());
+        std::reverse(Y_aligned.begin(), Y_aligned.end());
+    }
+
+    // Traceback from (i, j) until the path reaches row i_stop (-1: all the way to (0, 0)).
+    // Appends to the aligned sequences backwards and returns the column it stopped at, so a
+    // caller holding only some rows of S can trace its part and hand over the rest.
+    template <typename Matrix>
+    int traceback_segment(const Matrix& S, float** SUB, std::unordered_map<char, int>& cmap, int i, int j, int i_stop) {
         gap_penalty = SUB[0][cmap['*']];
 
-        while (i > 0 || j > 0) {
-            if (i > 0 && j > 0  && (S[i][j] == S[i - 1][j - 1] + SUB[ cmap.at(X[i-1]) ][ cmap.at(Y[j-1]) ])) {
+        while ((i > 0 || j > 0) && i > i_stop) {
+            if (i > 0 && j > 0  && (cell(S, i, j) == cell(S, i - 1, j - 1) + SUB[ cmap.at(X[i-1]) ][ cmap.at(Y[j-1]) ])) {
                 // diagonal top-left
-                X_aligned.insert(X_aligned.begin(),  X[i - 1]);
-                Y_aligned.insert(Y_aligned.begin(),  Y[j - 1]);
+                X_aligned.push_back(X[i - 1]);
+                Y_aligned.push_back(Y[j - 1]);
                 
                 if (SUB[ cmap.at(X[i-1]) ][ cmap.at(Y[j-1]) ] > 0) {
                     similarity_score += 1;
@@ -70,23 +286,125 @@ struct SequenceInfo {
                         identity_score += 1;
                 }
                 i--; j--;
-            } else if (i > 0  && S[i][j] == (S[i - 1][j] + gap_penalty)) {
+            } else if (i > 0  && cell(S, i, j) == (cell(S, i - 1, j) + gap_penalty)) {
                 // left
-                X_aligned.insert(X_aligned.begin(),  X[i - 1]);
-                Y_aligned.insert(Y_aligned.begin(),  '-');
+                X_aligned.push_back(X[i - 1]);
+                Y_aligned.push_back('-');
                 gap_count++;
                 i--;
             } else {
                 if ( j <= 0 ) break;
                 // up
-                X_aligned.insert(X_aligned.begin(),  '-');
-                Y_aligned.insert(Y_aligned.begin(),  Y[j - 1]);
+                X_aligned.push_back('-');
+                Y_aligned.push_back(Y[j - 1]);
                 gap_count++;
 
                 j--;
             }
         }
 
+        return j;
+    }
+
+    // Traceback of the affine gap matrices, and write aligned sequences
+    void traceback_affine_and_save(std::string filename, const AffineMatrix& A, float** SUB, std::unordered_map<char, int>& cmap, float gap_open, bool print=false) {
+        std::remove(filename.c_str());
+        traceback_affine(A, SUB, cmap, gap_open);
+        save_alignment(filename, print);
+    }
+
+    // Traceback through the H, E and F states with the same priority as traceback (diagonal,
+    // up, left). A gap is followed back until the cell where it was opened, every other step of
+    // it is an extension, so only gap_open is needed. With gap_open equal to gap_extend this is
+    // the linear gap path.
+    void traceback_affine(const AffineMatrix& A, float** SUB, std::unordered_map<char, int>& cmap, float gap_open) {
+        enum { IN_H, IN_F, IN_E } state = IN_H;
+        int i = X.size();
+        int j = Y.size();
+
+        while (i > 0 || j > 0) {
+            const AffineCell& c = A.get(i, j);
+            if (state == IN_H) {
+                if (i > 0 && j > 0 && c.H == A.get(i - 1, j - 1).H + SUB[ cmap.at(X[i-1]) ][ cmap.at(Y[j-1]) ]) {
+                    X_aligned.push_back(X[i - 1]);
+                    Y_aligned.push_back(Y[j - 1]);
+
+                    if (SUB[ cmap.at(X[i-1]) ][ cmap.at(Y[j-1]) ] > 0) {
+                        similarity_score += 1;
+                        if (X[i - 1] == Y[j - 1])
+                            identity_score += 1;
+                    }
+                    i--; j--;
+                    continue;
+                }
+                if (i > 0 && c.H == c.F) state = IN_F;
+                else if (j > 0) state = IN_E;
+                else break;
+            }
+
+            if (state == IN_F) {
+                // up, back to H where the gap was opened
+                X_aligned.push_back(X[i - 1]);
+                Y_aligned.push_back('-');
+                gap_count++;
+                if (c.F == A.get(i - 1, j).H + gap_open) state = IN_H;
+                i--;
+            } else {
+                // left
+                X_aligned.push_back('-');
+                Y_aligned.push_back(Y[j - 1]);
+                gap_count++;
+                if (c.E == A.get(i, j - 1).H + gap_open) state = IN_H;
+                j--;
+            }
+        }
+
+        std::reverse(X_aligned.begin(), X_aligned.end());
+        std::reverse(Y_aligned.begin(), Y_aligned.end());
+    }
+
+    // Traceback from recorded moves instead of S, and write aligned sequences
+    void traceback_directions_and_save(std::string filename, const DirectionMatrix& D, float** SUB, std::unordered_map<char, int>& cmap, bool print=false) {
+        traceback_directions(D, SUB, cmap);
+        save_alignment(filename, print);
+    }
+
+    // Traceback from recorded moves only
+    void traceback_directions(const DirectionMatrix& D, float** SUB, std::unordered_map<char, int>& cmap) {
+        int i = X.size();
+        int j = Y.size();
+
+        while (i > 0 || j > 0) {
+            int d = D.get(i, j);
+            if (d == DirectionMatrix::DIAG) {
+                X_aligned.push_back(X[i - 1]);
+                Y_aligned.push_back(Y[j - 1]);
+
+                if (SUB[ cmap.at(X[i-1]) ][ cmap.at(Y[j-1]) ] > 0) {
+                    similarity_score += 1;
+                    if (X[i - 1] == Y[j - 1])
+                        identity_score += 1;
+                }
+                i--; j--;
+            } else if (d == DirectionMatrix::UP) {
+                X_aligned.push_back(X[i - 1]);
+                Y_aligned.push_back('-');
+                gap_count++;
+                i--;
+            } else {
+                X_aligned.push_back('-');
+                Y_aligned.push_back(Y[j - 1]);
+                gap_count++;
+                j--;
+            }
+        }
+
+        std::reverse(X_aligned.begin(), X_aligned.end());
+        std::reverse(Y_aligned.begin(), Y_aligned.end());
+    }
+
+    // Write aligned sequences (and optionally print them)
+    void save_alignment(std::string filename, bool print=false) {
         if (print) {
             for ( auto& el: X_aligned)
                 std::cout << el;
@@ -105,30 +423,22 @@ struct SequenceInfo {
         ofs.close();
     }
 
-    // Load sequences from input files 
-    std::vector<char> load_sequence(std::string filename) {
-        std::ifstream ifs(filename);
-
-        std::vector<char> res;
-
-        if (!ifs.good()) {
-            std::cerr << "[error]: could not open input file '" << filename << "'!" << std::endl;
-            exit(-1);
-        }
-
-        ifs.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-        std::string line;
-        while (std::getline(ifs, line)) {
-            // str += line; 
-            for ( auto& c: line ) {
-                res.push_back(c);
-            }
-        }
-
-        ifs.close();
+    // Encode sequences once, so kernels do not look up cmap for every cell
+    void encode_sequences(std::unordered_map<char, int>& cmap) {
+        X_codes.resize(X.size());
+        Y_codes.resize(Y.size());
+        for (unsigned int i = 0; i < X.size(); ++i)
+            X_codes[i] = cmap.at(X[i]);
+        for (unsigned int j = 0; j < Y.size(); ++j)
+            Y_codes[j] = cmap.at(Y[j]);
+    }
 
-        return res;
+    // Load sequences from input files (first record of a FASTA file)
+    std::vector<char> load_sequence(std::string filename) {
+        FastaReader reader(filename);
+        FastaRecord rec;
+        reader.next(rec);
+        return rec.seq;
     }
 
     // Read Block Substitution Matrix (BLOSUM62)
@@ -175,11 +485,12 @@ struct SequenceInfo {
     // Make a substitution matrix from a scoring scheme
     float** substitution_matrix_from_scheme(float match, float mismatch, float gap_penalty, std::string letters, std::unordered_map<char, int>& cmap) {
         int size = letters.size()+1;
+        SUB_size = size;
         float** SUB = allocate(size, size, 0);
         for (int i=0; i<size; ++i) {
             SUB[i][size-1] = gap_penalty;
             SUB[size-1][i] = gap_penalty;
-            cmap[letters[i]] = i;
+            if (i < size-1) cmap[letters[i]] = i;
         }
         cmap['*'] = letters.size();
         
@@ -192,24 +503,17 @@ struct SequenceInfo {
         return SUB;
     }
 
-    // Reset between the runs
-    void reset(float** S) {
+    // Reset of the results between the runs. S is not cleared: every version writes all the cells
+    // it reads, so zeroing the matrix was a full sweep of it for nothing.
+    void reset() {
         X_aligned.clear();
         Y_aligned.clear();
-        X_aligned.resize(0);
-        Y_aligned.resize(0);
-
-        for (int i = 0; i < rows; i++)
-        {
-            for (int j = 0; j < cols; j++)
-            {
-                S[i][j] = 0.0;
-            }
-        }
 
         similarity_score = 0;
         identity_score = 0;
         gap_count = 0;
+        alignment_score = 0;
+        band_status = BandStatus();
     }
 
     // Verification of results
@@ -240,10 +544,15 @@ struct SequenceInfo {
     }
 };
 
+// Giga cell updates per second
+double gcups(int rows, int cols, double seconds) {
+    return (double)(rows-1)*(cols-1) / seconds / 1e9;
+}
+
 // Parsing arguments
-void parse_args(int argc, char **argv, std::string &X, std::string &Y, std::string &output_filename, int& grain_size, int& exec_mode, bool &only_exec_times)
+void parse_args(int argc, char **argv, std::string &X, std::string &Y, std::string &output_filename, int& grain_size, int& exec_mode, bool &only_exec_times, int& tile_rows, int& tile_cols, int& band_width, float& x_drop, bool& batch, std::string& pairs_filename, bool& numa, bool& huge_pages, std::string& revised_X, std::string& revised_Y, float& gap_open, float& gap_extend)
 {
-    std::string usage("Usage: --x <sequence1-filename> --y <sequence2-filename> --save-to <output-filename> --exec-mode <integer> --grain-size --print-runtime-only");
+    std::string usage("Usage: --x <sequence1-filename> --y <sequence2-filename> --save-to <output-filename> --exec-mode <integer> --grain-size --tile-rows <integer> --tile-cols <integer> --band-width <integer> --x-drop <score> --batch --pairs <pairs-filename> --numa --huge-pages --revised-x <sequence1-filename> --revised-y <sequence2-filename> --gap-open <score> --gap-extend <score> --print-runtime-only");
 
     for (int i = 0; i < argc; ++i) {
         if (std::string(argv[i]).compare("--print-runtime-only") == 0)
@@ -254,6 +563,30 @@ void parse_args(int argc, char **argv, std::string &X, std::string &Y, std::stri
             exec_mode = std::stoi(argv[++i]);
         else if (std::string(argv[i]).compare("--grain-size") == 0)
             grain_size = std::stoi(argv[++i]);
+        else if (std::string(argv[i]).compare("--tile-rows") == 0)
+            tile_rows = std::stoi(argv[++i]);
+        else if (std::string(argv[i]).compare("--tile-cols") == 0)
+            tile_cols = std::stoi(argv[++i]);
+        else if (std::string(argv[i]).compare("--band-width") == 0)
+            band_width = std::stoi(argv[++i]);
+        else if (std::string(argv[i]).compare("--x-drop") == 0)
+            x_drop = std::stof(argv[++i]);
+        else if (std::string(argv[i]).compare("--batch") == 0)
+            batch = true;
+        else if (std::string(argv[i]).compare("--pairs") == 0)
+            pairs_filename = std::string(argv[++i]);
+        else if (std::string(argv[i]).compare("--numa") == 0)
+            numa = true;
+        else if (std::string(argv[i]).compare("--huge-pages") == 0)
+            huge_pages = numa = true;
+        else if (std::string(argv[i]).compare("--revised-x") == 0)
+            revised_X = std::string(argv[++i]);
+        else if (std::string(argv[i]).compare("--revised-y") == 0)
+            revised_Y = std::string(argv[++i]);
+        else if (std::string(argv[i]).compare("--gap-open") == 0)
+            gap_open = std::stof(argv[++i]);
+        else if (std::string(argv[i]).compare("--gap-extend") == 0)
+            gap_extend = std::stof(argv[++i]);
         else if (std::string(argv[i]).compare("--y") == 0)
             Y = std::string(argv[++i]);
         else if (std::string(argv[i]).compare("--save-to") == 0)
@@ -263,5 +596,10 @@ void parse_args(int argc, char **argv, std::string &X, std::string &Y, std::stri
             exit(-1);
         }
     }
+
+    if (tile_rows < 1 || tile_cols < 1) {
+        std::cerr << "[error]: --tile-rows and --tile-cols must be at least 1!" << std::endl;
+        exit(-1);
+    }
 }
 #endif
\ No newline at end of file
@@ -1,6 +1,16 @@
 #include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <limits>
 #include <omp.h>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 #include "helpers.hpp"
+#include "work_stealing.hpp"
+#include "trace.hpp"
+#include "scoring.hpp"
 
 unsigned long SequenceInfo::gpsa_sequential(float **S, float **SUB, std::unordered_map<char, int> &cmap)
 {
@@ -66,17 +76,20 @@ unsigned long SequenceInfo::gpsa_taskloop(float **S, float **SUB, std::unordered
 #pragma omp parallel
 #pragma omp single
 	{
-		for (int D = 0; D < rows + cols - 1 - tile_size; D += tile_size)
+		// p is the column offset and q the row offset of a tile, tiles with p + q = steps * tile_size
+		// form one wavefront
+		int n_tr = (rows - 2) / tile_size + 1, n_tc = (cols - 2) / tile_size + 1;
+		for (int steps = 0; steps < n_tr + n_tc - 1; steps++)
 		{
-			int steps = (int)D / tile_size;
 #pragma omp taskloop reduction(+ : visited) grainsize(grain_size)
-			for (int p = std::max((steps - tile_size) * tile_size, 0); p <= tile_size * steps; p += tile_size)
+			for (int p = std::max(steps - n_tr + 1, 0) * tile_size; p <= tile_size * steps; p += tile_size)
 			{
-				if (p < rows - 1)
+				if (p < cols - 1)
 				{
 					int q = std::abs(p - tile_size * steps);
 					if (q < rows - 1)
 					{
+						GPSA_TRACE_TILE(q / tile_size, p / tile_size, omp_get_thread_num());
 
 						for (int d = 0; d < 2 * tile_size - 1; d++)
 						{
@@ -85,11 +98,11 @@ unsigned long SequenceInfo::gpsa_taskloop(float **S, float **SUB, std::unordered
 							{
 								int j = d - i;
 
-								if (i < tile_size && j < tile_size && i >= 0 && j >= 0)
-								{
-									int m = i + p + 1;
-									int n = j + q + 1;
+								int m = i + p + 1; // column
+								int n = j + q + 1; // row
 
+								if (i < tile_size && j < tile_size && i >= 0 && j >= 0 && m < cols && n < rows)
+								{
 									float match = S[n - 1][m - 1] + SUB[cmap.at(X[n - 1])][cmap.at(Y[m - 1])];
 									float del = S[n - 1][m] + gap_penalty;
 									float insert = S[n][m - 1] + gap_penalty;
@@ -187,3 +200,1537 @@ unsigned long SequenceInfo::gpsa_tasks(float **S, float **SUB, std::unordered_ma
 
 	return visited;
 }
+
+// Hirschberg (linear space) helpers.
+// A subproblem is the rectangle of S with its top-left corner at (r0, c0), whose top row T
+// and left column L are known. It is traced back from its bottom-right corner, using the same
+// rules as traceback_and_save, until the path leaves through the top row or the left column.
+struct HirschbergContext
+{
+	const int *x, *y;	// encoded sequences
+	const float *sub;	// flat substitution matrix
+	int sub_size;
+	float gap_penalty;
+	int base_cells;		// rectangles smaller than this are solved with a full local matrix
+	int task_cells;		// rectangles smaller than this are not split into tasks
+	unsigned long visited;
+};
+
+// Computes row i of the rectangle from row i-1
+static inline void hirschberg_row(const HirschbergContext &ctx, int r0, int c0, int i, const float *prev, float *cur, float left, int w)
+{
+	const float *sub_row = ctx.sub + ctx.x[r0 + i - 1] * ctx.sub_size;
+	const int *y = ctx.y + c0 - 1;
+
+	cur[0] = left;
+	for (int j = 1; j < w; j++)
+	{
+		float match = prev[j - 1] + sub_row[y[j]];
+		float del = prev[j] + ctx.gap_penalty;
+		float insert = cur[j - 1] + ctx.gap_penalty;
+		cur[j] = std::max({match, del, insert});
+	}
+}
+
+// Small rectangles: full local matrix and a plain traceback
+static void hirschberg_base(HirschbergContext &ctx, int r0, int c0, const std::vector<float> &T, const std::vector<float> &L, std::string &moves, int &ei, int &ej)
+{
+	int h = L.size(), w = T.size();
+	std::vector<float> M(h * w);
+
+	std::copy(T.begin(), T.end(), M.begin());
+	for (int i = 1; i < h; i++)
+		hirschberg_row(ctx, r0, c0, i, &M[(i - 1) * w], &M[i * w], L[i], w);
+
+	int i = h - 1, j = w - 1;
+	while (i > 0 && j > 0)
+	{
+		float s = M[i * w + j];
+		if (s == M[(i - 1) * w + j - 1] + ctx.sub[ctx.x[r0 + i - 1] * ctx.sub_size + ctx.y[c0 + j - 1]])
+		{
+			moves.push_back('D');
+			i--; j--;
+		}
+		else if (s == M[(i - 1) * w + j] + ctx.gap_penalty)
+		{
+			moves.push_back('U');
+			i--;
+		}
+		else
+		{
+			moves.push_back('L');
+			j--;
+		}
+	}
+
+#pragma omp atomic
+	ctx.visited += (unsigned long)(h - 1) * (w - 1);
+
+	ei = r0 + i;
+	ej = c0 + j;
+}
+
+static void hirschberg_solve(HirschbergContext &ctx, int r0, int c0, const std::vector<float> &T, const std::vector<float> &L, std::string &moves, int &ei, int &ej)
+{
+	int h = L.size(), w = T.size();
+
+	// Start is already on the boundary
+	if (h <= 1 || w <= 1)
+	{
+		ei = r0 + h - 1;
+		ej = c0 + w - 1;
+		return;
+	}
+
+	if (h <= 2 || w <= 2 || (long)h * w <= ctx.base_cells)
+	{
+		hirschberg_base(ctx, r0, c0, T, L, moves, ei, ej);
+		return;
+	}
+
+	// Forward sweep over the whole rectangle. Below the middle row, every cell also carries the
+	// column where its traceback path first reaches the middle row (-1 if it leaves through the
+	// left column before that), so the crossing point of the path is known after one pass.
+	int mid = h / 2;
+	std::vector<float> prev(T), cur(w), row_mid;
+	std::vector<int> cross_prev(w), cross_cur(w);
+
+	for (int i = 1; i < h; i++)
+	{
+		hirschberg_row(ctx, r0, c0, i, prev.data(), cur.data(), L[i], w);
+
+		if (i == mid)
+		{
+			row_mid = cur;
+			for (int j = 0; j < w; j++)
+				cross_cur[j] = j;
+		}
+		else if (i > mid)
+		{
+			const float *sub_row = ctx.sub + ctx.x[r0 + i - 1] * ctx.sub_size;
+			cross_cur[0] = -1;
+			for (int j = 1; j < w; j++)
+			{
+				if (cur[j] == prev[j - 1] + sub_row[ctx.y[c0 + j - 1]])
+					cross_cur[j] = cross_prev[j - 1];
+				else if (cur[j] == prev[j] + ctx.gap_penalty)
+					cross_cur[j] = cross_prev[j];
+				else
+					cross_cur[j] = cross_cur[j - 1];
+			}
+		}
+		std::swap(prev, cur);
+		std::swap(cross_prev, cross_cur);
+	}
+
+#pragma omp atomic
+	ctx.visited += (unsigned long)(h - 1) * (w - 1);
+
+	int c = cross_prev[w - 1];
+
+	// The path never reaches the middle row: only the bottom half matters
+	if (c < 0)
+	{
+		hirschberg_solve(ctx, r0 + mid, c0, row_mid, std::vector<float>(L.begin() + mid, L.end()), moves, ei, ej);
+		return;
+	}
+
+	std::vector<float> T_top(T.begin(), T.begin() + c + 1), L_top(L.begin(), L.begin() + mid + 1);
+	std::vector<float> T_bottom(row_mid.begin() + c, row_mid.end()), L_bottom;
+	std::string moves_top, moves_bottom;
+	int top_i, top_j, bottom_i, bottom_j;
+	bool split = (long)h * w > ctx.task_cells;
+
+#pragma omp task shared(ctx, T_top, L_top, moves_top, top_i, top_j) if (split)
+	hirschberg_solve(ctx, r0, c0, T_top, L_top, moves_top, top_i, top_j);
+
+#pragma omp task shared(ctx, L, row_mid, T_bottom, L_bottom, moves_bottom, bottom_i, bottom_j) if (split)
+	{
+		// Left column of the bottom half is column c of S, recompute it from the middle row
+		if (c == 0)
+			L_bottom.assign(L.begin() + mid, L.end());
+		else
+		{
+			std::vector<float> p(row_mid.begin(), row_mid.begin() + c + 1), q(c + 1);
+			L_bottom.push_back(p[c]);
+			for (int i = mid + 1; i < h; i++)
+			{
+				hirschberg_row(ctx, r0, c0, i, p.data(), q.data(), L[i], c + 1);
+				L_bottom.push_back(q[c]);
+				std::swap(p, q);
+			}
+		}
+		hirschberg_solve(ctx, r0 + mid, c0 + c, T_bottom, L_bottom, moves_bottom, bottom_i, bottom_j);
+	}
+
+#pragma omp taskwait
+
+	// Bottom half ends either at (mid, c) or on column c, from where the path goes straight up
+	moves += moves_bottom;
+	moves.append(bottom_i - (r0 + mid), 'U');
+	moves += moves_top;
+
+	ei = top_i;
+	ej = top_j;
+}
+
+unsigned long SequenceInfo::gpsa_hirschberg(float **SUB, std::unordered_map<char, int> &cmap)
+{
+	gap_penalty = SUB[0][cmap['*']]; // min score
+
+	encode_sequences(cmap);
+	const std::vector<int> &x = X_codes, &y = Y_codes;
+
+	HirschbergContext ctx = {x.data(), y.data(), SUB[0], SUB_size, gap_penalty, 1 << 14, 1 << 20, 0};
+
+	// Boundary
+	std::vector<float> T(cols), L(rows);
+	for (int j = 0; j < cols; j++)
+		T[j] = j * gap_penalty;
+	for (int i = 0; i < rows; i++)
+		L[i] = i * gap_penalty;
+	ctx.visited = rows + cols - 1;
+
+	std::string moves;
+	int i, j;
+
+#pragma omp parallel
+#pragma omp single
+	hirschberg_solve(ctx, 0, 0, T, L, moves, i, j);
+
+	// Remaining boundary moves, then walk the path forwards
+	moves.append(i, 'U');
+	moves.append(j, 'L');
+
+	X_aligned.reserve(moves.size());
+	Y_aligned.reserve(moves.size());
+	i = 0; j = 0;
+	for (auto it = moves.rbegin(); it != moves.rend(); ++it)
+	{
+		if (*it == 'D')
+		{
+			float s = SUB[x[i]][y[j]];
+			X_aligned.push_back(X[i]);
+			Y_aligned.push_back(Y[j]);
+			if (s > 0)
+			{
+				similarity_score += 1;
+				if (X[i] == Y[j])
+					identity_score += 1;
+			}
+			alignment_score += s;
+			i++; j++;
+		}
+		else if (*it == 'U')
+		{
+			X_aligned.push_back(X[i]);
+			Y_aligned.push_back('-');
+			gap_count++;
+			alignment_score += gap_penalty;
+			i++;
+		}
+		else
+		{
+			X_aligned.push_back('-');
+			Y_aligned.push_back(Y[j]);
+			gap_count++;
+			alignment_score += gap_penalty;
+			j++;
+		}
+	}
+
+	return ctx.visited;
+}
+
+// Anti-diagonal kernel. S is filled in horizontal strips; inside a strip each diagonal d = k + j
+// is kept in a contiguous buffer indexed by the local row k, and Y is stored reversed, so the
+// cells of a diagonal segment read consecutive elements of the two previous diagonals and of both
+// sequences. Vectorized with AVX-512 or AVX2 when compiled for it (-march=native), otherwise the
+// scalar loop is left to the compiler. The strip height bounds how many rows of S are written at
+// once when the diagonal is stored back for the traceback.
+unsigned long SequenceInfo::gpsa_simd(float **S, float **SUB, std::unordered_map<char, int> &cmap)
+{
+	unsigned long visited = 0;
+	gap_penalty = SUB[0][cmap['*']]; // min score
+	encode_sequences(cmap);
+
+	int strip = 256;
+
+	// Boundary
+	for (int i = 1; i < rows; i++)
+	{
+		S[i][0] = i * gap_penalty;
+		visited++;
+	}
+
+	for (int j = 0; j < cols; j++)
+	{
+		S[0][j] = j * gap_penalty;
+		visited++;
+	}
+
+	// Row offsets into the flat substitution matrix and the reversed Y
+	const float *sub = SUB[0];
+	std::vector<int> x_off(rows - 1), y_rev(cols - 1);
+	for (int i = 0; i < rows - 1; i++)
+		x_off[i] = X_codes[i] * SUB_size;
+	for (int j = 0; j < cols - 1; j++)
+		y_rev[j] = Y_codes[cols - 2 - j];
+
+	// Diagonals d-2, d-1 and d of the current strip; local row 0 is the last row of the previous strip
+	std::vector<float> buf0(strip + 1), buf1(strip + 1), buf2(strip + 1);
+
+	for (int r0 = 1; r0 < rows; r0 += strip)
+	{
+		int h = std::min(strip, rows - r0);
+		float *prev2 = buf0.data(), *prev1 = buf1.data(), *cur = buf2.data();
+		const int *x = x_off.data() + r0 - 1;
+
+		prev2[0] = S[r0 - 1][0];
+		prev1[0] = S[r0 - 1][1];
+		prev1[1] = S[r0][0];
+
+		for (int d = 2; d < h + cols; d++)
+		{
+			int k_lo = std::max(1, d - (cols - 1)), k_hi = std::min(h, d - 1);
+
+			if (d < cols)
+				cur[0] = S[r0 - 1][d];
+			if (d <= h)
+				cur[d] = S[r0 - 1 + d][0];
+
+			// Y[j-1] with j = d-k, i.e. y_rev[cols-1-d+k]
+			const int *y = y_rev.data() + cols - 1 - d;
+			int k = k_lo;
+
+#if defined(__AVX512F__)
+			const __m512 gap16 = _mm512_set1_ps(gap_penalty);
+			for (; k + 16 <= k_hi + 1; k += 16)
+			{
+				__m512i idx = _mm512_add_epi32(_mm512_loadu_si512(x + k - 1), _mm512_loadu_si512(y + k));
+				__m512 match = _mm512_add_ps(_mm512_loadu_ps(prev2 + k - 1), _mm512_i32gather_ps(idx, sub, 4));
+				__m512 del = _mm512_add_ps(_mm512_loadu_ps(prev1 + k - 1), gap16);
+				__m512 insert = _mm512_add_ps(_mm512_loadu_ps(prev1 + k), gap16);
+				_mm512_storeu_ps(cur + k, _mm512_max_ps(match, _mm512_max_ps(del, insert)));
+			}
+#endif
+#if defined(__AVX2__)
+			const __m256 gap8 = _mm256_set1_ps(gap_penalty);
+			for (; k + 8 <= k_hi + 1; k += 8)
+			{
+				__m256i idx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(x + k - 1)), _mm256_loadu_si256((const __m256i *)(y + k)));
+				__m256 match = _mm256_add_ps(_mm256_loadu_ps(prev2 + k - 1), _mm256_i32gather_ps(sub, idx, 4));
+				__m256 del = _mm256_add_ps(_mm256_loadu_ps(prev1 + k - 1), gap8);
+				__m256 insert = _mm256_add_ps(_mm256_loadu_ps(prev1 + k), gap8);
+				_mm256_storeu_ps(cur + k, _mm256_max_ps(match, _mm256_max_ps(del, insert)));
+			}
+#endif
+			for (; k <= k_hi; k++)
+			{
+				float match = prev2[k - 1] + sub[x[k - 1] + y[k]];
+				float del = prev1[k - 1] + gap_penalty;
+				float insert = prev1[k] + gap_penalty;
+				cur[k] = std::max({match, del, insert});
+			}
+
+			// Keep S for the traceback
+			for (k = k_lo; k <= k_hi; k++)
+				S[r0 - 1 + k][d - k] = cur[k];
+			visited += k_hi - k_lo + 1;
+
+			std::swap(prev2, prev1);
+			std::swap(prev1, cur);
+		}
+	}
+
+	return visited;
+}
+
+// Vector operations for the striped kernel: saturating 16-bit and plain 32-bit lanes.
+// shift_in moves every lane one position up and puts x into lane 0.
+#if defined(__AVX2__)
+struct StripedInt16
+{
+	typedef __m256i vec;
+	typedef int16_t elem;
+	static const int lanes = 16;
+	static vec set1(elem x) { return _mm256_set1_epi16(x); }
+	static vec add(vec a, vec b) { return _mm256_adds_epi16(a, b); }
+	static vec max(vec a, vec b) { return _mm256_max_epi16(a, b); }
+	static bool any_gt(vec a, vec b) { return _mm256_movemask_epi8(_mm256_cmpgt_epi16(a, b)) != 0; }
+	static vec load(const elem *p) { return _mm256_loadu_si256((const __m256i *)p); }
+	static void store(elem *p, vec a) { _mm256_storeu_si256((__m256i *)p, a); }
+	static vec shift_in(vec a, elem x)
+	{
+		a = _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 14);
+		return _mm256_insert_epi16(a, x, 0);
+	}
+};
+
+struct StripedInt32
+{
+	typedef __m256i vec;
+	typedef int32_t elem;
+	static const int lanes = 8;
+	static vec set1(elem x) { return _mm256_set1_epi32(x); }
+	static vec add(vec a, vec b) { return _mm256_add_epi32(a, b); }
+	static vec max(vec a, vec b) { return _mm256_max_epi32(a, b); }
+	static bool any_gt(vec a, vec b) { return _mm256_movemask_epi8(_mm256_cmpgt_epi32(a, b)) != 0; }
+	static vec load(const elem *p) { return _mm256_loadu_si256((const __m256i *)p); }
+	static void store(elem *p, vec a) { _mm256_storeu_si256((__m256i *)p, a); }
+	static vec shift_in(vec a, elem x)
+	{
+		a = _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 12);
+		return _mm256_insert_epi32(a, x, 0);
+	}
+};
+#else
+template <typename T, int N>
+struct StripedScalar
+{
+	struct vec { T v[N]; };
+	typedef T elem;
+	static const int lanes = N;
+	static vec set1(elem x)
+	{
+		vec r;
+		for (int l = 0; l < N; l++) r.v[l] = x;
+		return r;
+	}
+	static vec add(vec a, vec b)
+	{
+		vec r;
+		for (int l = 0; l < N; l++)
+			r.v[l] = (T)std::clamp<int64_t>((int64_t)a.v[l] + b.v[l], std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+		return r;
+	}
+	static vec max(vec a, vec b)
+	{
+		vec r;
+		for (int l = 0; l < N; l++) r.v[l] = std::max(a.v[l], b.v[l]);
+		return r;
+	}
+	static bool any_gt(vec a, vec b)
+	{
+		for (int l = 0; l < N; l++)
+			if (a.v[l] > b.v[l]) return true;
+		return false;
+	}
+	static vec load(const elem *p)
+	{
+		vec r;
+		std::copy(p, p + N, r.v);
+		return r;
+	}
+	static void store(elem *p, vec a) { std::copy(a.v, a.v + N, p); }
+	static vec shift_in(vec a, elem x)
+	{
+		vec r;
+		r.v[0] = x;
+		for (int l = 1; l < N; l++) r.v[l] = a.v[l - 1];
+		return r;
+	}
+};
+typedef StripedScalar<int16_t, 8> StripedInt16;
+typedef StripedScalar<int32_t, 4> StripedInt32;
+#endif
+
+// Striped (Farrar) fill of S. Y is the query: position q lives in lane q / seg_len of segment
+// q % seg_len, and a query profile holds the substitution scores of every residue against the
+// striped query, so the inner loop is a plain vector add. Rows of X are processed one at a time
+// and written back to S for the traceback. Returns false if a 16-bit score saturated.
+// The vectors are kept as plain arrays of lanes and moved with unaligned loads and stores, a
+// std::vector of a vector type does not guarantee its alignment.
+template <typename V>
+bool striped_fill(float **S, float **SUB, int sub_size, const std::vector<int> &x, const std::vector<int> &y, int gap)
+{
+	typedef typename V::vec vec;
+	typedef typename V::elem elem;
+
+	int rows = x.size() + 1, m = y.size();
+	int seg_len = (m + V::lanes - 1) / V::lanes;
+	elem neg = std::numeric_limits<elem>::min() / (sizeof(elem) == 2 ? 1 : 2);
+	elem lo = std::numeric_limits<elem>::min(), hi = std::numeric_limits<elem>::max();
+
+	// Query profile
+	const int L = V::lanes;
+	std::vector<elem> profile(sub_size * seg_len * L);
+	for (int a = 0; a < sub_size; a++)
+		for (int s = 0; s < seg_len; s++)
+			for (int l = 0; l < L; l++)
+			{
+				int q = l * seg_len + s;
+				profile[(a * seg_len + s) * L + l] = q < m ? (elem)SUB[a][y[q]] : 0;
+			}
+
+	// Row 0
+	std::vector<elem> H_prev(seg_len * L), H_cur(seg_len * L);
+	for (int s = 0; s < seg_len; s++)
+		for (int l = 0; l < L; l++)
+			H_prev[s * L + l] = (elem)((l * seg_len + s + 1) * gap);
+
+	const vec v_gap = V::set1(gap);
+	const vec v_neg = V::set1(neg);
+
+	for (int i = 1; i < rows; i++)
+	{
+		const elem *prof = &profile[x[i - 1] * seg_len * L];
+		vec H_diag = V::shift_in(V::load(&H_prev[(seg_len - 1) * L]), (elem)((i - 1) * gap));
+		vec F = V::shift_in(v_neg, (elem)((i + 1) * gap));
+
+		for (int s = 0; s < seg_len; s++)
+		{
+			vec up = V::load(&H_prev[s * L]);
+			vec H = V::add(H_diag, V::load(&prof[s * L]));
+			H = V::max(H, V::add(up, v_gap));
+			H = V::max(H, F);
+			H_diag = up;
+			V::store(&H_cur[s * L], H);
+			F = V::add(H, v_gap);
+		}
+
+		// Lazy F: carry the horizontal gaps across lane boundaries until they no longer win
+		F = V::shift_in(F, neg);
+		int s = 0;
+		vec H;
+		while (V::any_gt(F, H = V::load(&H_cur[s * L])))
+		{
+			V::store(&H_cur[s * L], V::max(H, F));
+			F = V::add(F, v_gap);
+			if (++s == seg_len)
+			{
+				F = V::shift_in(F, neg);
+				s = 0;
+			}
+		}
+
+		// Back to S, row major
+		float *S_row = S[i] + 1;
+		for (int l = 0; l < L; l++)
+			for (s = 0; s < seg_len; s++)
+			{
+				int q = l * seg_len + s;
+				if (q >= m)
+					break;
+				elem h = H_cur[s * L + l];
+				if (h == lo || h == hi)
+					return false;
+				S_row[q] = h;
+			}
+
+		std::swap(H_prev, H_cur);
+	}
+
+	return true;
+}
+
+unsigned long SequenceInfo::gpsa_striped(float **S, float **SUB, std::unordered_map<char, int> &cmap)
+{
+	unsigned long visited = 0;
+	gap_penalty = SUB[0][cmap['*']]; // min score
+
+	// Integer kernels need integer scores, otherwise use the float version
+	for (int a = 0; a < SUB_size; a++)
+		for (int b = 0; b < SUB_size; b++)
+			if (SUB[a][b] != std::round(SUB[a][b]))
+			{
+				score_bits = 0;
+				return gpsa_sequential(S, SUB, cmap);
+			}
+
+	encode_sequences(cmap);
+
+	// Boundary
+	for (int i = 1; i < rows; i++)
+	{
+		S[i][0] = i * gap_penalty;
+		visited++;
+	}
+
+	for (int j = 0; j < cols; j++)
+	{
+		S[0][j] = j * gap_penalty;
+		visited++;
+	}
+
+	// 16-bit first when the boundary fits, 32-bit if anything saturates
+	int gap = (int)gap_penalty;
+	bool done = false;
+	if ((long)std::max(rows, cols) * std::abs(gap) < std::numeric_limits<int16_t>::max())
+	{
+		score_bits = 16;
+		done = striped_fill<StripedInt16>(S, SUB, SUB_size, X_codes, Y_codes, gap);
+	}
+	if (!done)
+	{
+		score_bits = 32;
+		striped_fill<StripedInt32>(S, SUB, SUB_size, X_codes, Y_codes, gap);
+	}
+
+	visited += (unsigned long)(rows - 1) * (cols - 1);
+
+	return visited;
+}
+
+// Row by row fill of S[i_begin..i_end) x [j_begin..j_end), with encoded sequences
+static inline void fill_tile(float **S, const float *sub, int sub_size, const int *x, const int *y, float gap_penalty, int i_begin, int i_end, int j_begin, int j_end)
+{
+	for (int i = i_begin; i < i_end; i++)
+	{
+		const float *sub_row = sub + x[i - 1] * sub_size;
+		for (int j = j_begin; j < j_end; j++)
+		{
+			float match = S[i - 1][j - 1] + sub_row[y[j - 1]];
+			float del = S[i - 1][j] + gap_penalty;
+			float insert = S[i][j - 1] + gap_penalty;
+			S[i][j] = std::max({match, del, insert});
+		}
+	}
+}
+
+unsigned long SequenceInfo::gpsa_tiled(float **S, float **SUB, std::unordered_map<char, int> &cmap, int tile_rows, int tile_cols)
+{
+	unsigned long visited = 0;
+	gap_penalty = SUB[0][cmap['*']]; // min score
+	encode_sequences(cmap);
+
+	// Boundary
+	for (int i = 1; i < rows; i++)
+	{
+		S[i][0] = i * gap_penalty;
+		visited++;
+	}
+
+	for (int j = 0; j < cols; j++)
+	{
+		S[0][j] = j * gap_penalty;
+		visited++;
+	}
+
+	// One task per tile of the inner (rows-1)x(cols-1) cells. A tile waits for its north and west
+	// neighbours only (north-west is implied by both), so tiles of different wavefronts overlap
+	// and there is no barrier between diagonals. The affinity clause hints the runtime at the
+	// tile's rows; libgomp ignores it, so with --numa only gpsa_work_stealing keeps tiles on the
+	// node of their rows.
+	int n_tr = (rows - 2) / tile_rows + 1, n_tc = (cols - 2) / tile_cols + 1;
+	std::vector<char> tile_done(n_tr * n_tc);
+	char *dep = tile_done.data();
+	const float *sub = SUB[0];
+	const int *x = X_codes.data(), *y = Y_codes.data();
+
+#pragma omp parallel
+#pragma omp single
+	{
+		for (int ti = 0; ti < n_tr; ti++)
+		{
+			for (int tj = 0; tj < n_tc; tj++)
+			{
+				[[maybe_unused]] char *north = ti > 0 ? &dep[(ti - 1) * n_tc + tj] : &dep[ti * n_tc + tj];
+				[[maybe_unused]] char *west = tj > 0 ? &dep[ti * n_tc + tj - 1] : &dep[ti * n_tc + tj];
+
+#pragma omp task firstprivate(ti, tj) depend(in : north[0], west[0]) depend(out : dep[ti * n_tc + tj]) affinity(S[1 + ti * tile_rows][0])
+				{
+					int i_begin = 1 + ti * tile_rows, i_end = std::min(rows, i_begin + tile_rows);
+					int j_begin = 1 + tj * tile_cols, j_end = std::min(cols, j_begin + tile_cols);
+					GPSA_TRACE_TILE(ti, tj, omp_get_thread_num());
+
+					fill_tile(S, sub, SUB_size, x, y, gap_penalty, i_begin, i_end, j_begin, j_end);
+
+#pragma omp atomic
+					visited += (unsigned long)(i_end - i_begin) * (j_end - j_begin);
+				}
+			}
+		}
+	}
+
+	return visited;
+}
+
+// Same tiles as gpsa_tiled, scheduled by the work-stealing executor on std::threads
+unsigned long SequenceInfo::gpsa_work_stealing(float **S, float **SUB, std::unordered_map<char, int> &cmap, int tile_rows, int tile_cols, int n_threads, const NumaLayout *layout)
+{
+	unsigned long visited = 0;
+	gap_penalty = SUB[0][cmap['*']]; // min score
+	encode_sequences(cmap);
+
+	// Boundary
+	for (int i = 1; i < rows; i++)
+	{
+		S[i][0] = i * gap_penalty;
+		visited++;
+	}
+
+	for (int j = 0; j < cols; j++)
+	{
+		S[0][j] = j * gap_penalty;
+		visited++;
+	}
+
+	int n_tr = (rows - 2) / tile_rows + 1, n_tc = (cols - 2) / tile_cols + 1;
+	std::vector<unsigned long> visited_by(n_threads, 0);
+	const float *sub = SUB[0];
+	const int *x = X_codes.data(), *y = Y_codes.data();
+
+	run_tile_grid(n_tr, n_tc, n_threads, [&](int ti, int tj, int id)
+	{
+		int i_begin = 1 + ti * tile_rows, i_end = std::min(rows, i_begin + tile_rows);
+		int j_begin = 1 + tj * tile_cols, j_end = std::min(cols, j_begin + tile_cols);
+		GPSA_TRACE_TILE(ti, tj, id);
+
+		fill_tile(S, sub, SUB_size, x, y, gap_penalty, i_begin, i_end, j_begin, j_end);
+		visited_by[id] += (unsigned long)(i_end - i_begin) * (j_end - j_begin);
+	}, layout);
+
+	for (auto v : visited_by)
+		visited += v;
+
+	return visited;
+}
+
+// Same task graph as gpsa_tiled on the tile-major layout. A tile task first copies its halo
+// (last row of the north tile, last column of the west tile) into its own block, then fills the
+// block with a fixed stride, so all reads and writes stay in one contiguous block.
+unsigned long SequenceInfo::gpsa_blocked(BlockedMatrix &B, float **SUB, std::unordered_map<char, int> &cmap, int tile_rows, int tile_cols)
+{
+	unsigned long visited = 0;
+	gap_penalty = SUB[0][cmap['*']]; // min score
+	encode_sequences(cmap);
+	if (B.rows != rows || B.cols != cols || B.tile_rows != tile_rows || B.tile_cols != tile_cols)
+		B.resize(rows, cols, tile_rows, tile_cols);
+
+	// Boundary, in the halos of the first tile row and column
+	for (int i = 0; i < rows; i++)
+	{
+		B.at(i, 0) = i * gap_penalty;
+		visited++;
+	}
+
+	for (int j = 1; j < cols; j++)
+	{
+		B.at(0, j) = j * gap_penalty;
+		visited++;
+	}
+
+	// corners of the first tile row, the other halos are copied in by the tiles
+	for (int tj = 1; tj < B.n_tc; tj++)
+		B.tile(0, tj)[0] = tj * tile_cols * gap_penalty;
+
+	int n_tr = B.n_tr, n_tc = B.n_tc, stride = B.stride;
+	std::vector<char> tile_done(n_tr * n_tc);
+	char *dep = tile_done.data();
+	const float *sub = SUB[0];
+	const int *x = X_codes.data(), *y = Y_codes.data();
+
+#pragma omp parallel
+#pragma omp single
+	{
+		for (int ti = 0; ti < n_tr; ti++)
+		{
+			for (int tj = 0; tj < n_tc; tj++)
+			{
+				[[maybe_unused]] char *north = ti > 0 ? &dep[(ti - 1) * n_tc + tj] : &dep[ti * n_tc + tj];
+				[[maybe_unused]] char *west = tj > 0 ? &dep[ti * n_tc + tj - 1] : &dep[ti * n_tc + tj];
+
+#pragma omp task firstprivate(ti, tj) depend(in : north[0], west[0]) depend(out : dep[ti * n_tc + tj])
+				{
+					int i_begin = 1 + ti * tile_rows, h = std::min(rows, i_begin + tile_rows) - i_begin;
+					int j_begin = 1 + tj * tile_cols, w = std::min(cols, j_begin + tile_cols) - j_begin;
+					float *T = B.tile(ti, tj);
+					GPSA_TRACE_TILE(ti, tj, omp_get_thread_num());
+
+					// halo row including the corner, then halo column
+					if (ti > 0)
+						std::copy(B.tile(ti - 1, tj) + tile_rows * stride, B.tile(ti - 1, tj) + tile_rows * stride + w + 1, T);
+					if (tj > 0)
+					{
+						const float *W = B.tile(ti, tj - 1);
+						for (int li = 1; li <= h; li++)
+							T[li * stride] = W[li * stride + tile_cols];
+					}
+
+					for (int li = 1; li <= h; li++)
+					{
+						const float *sub_row = sub + x[i_begin + li - 2] * SUB_size;
+						float *up = T + (li - 1) * stride, *cur = T + li * stride;
+						for (int lj = 1; lj <= w; lj++)
+						{
+							float match = up[lj - 1] + sub_row[y[j_begin + lj - 2]];
+							float del = up[lj] + gap_penalty;
+							float insert = cur[lj - 1] + gap_penalty;
+							cur[lj] = std::max({match, del, insert});
+						}
+					}
+
+#pragma omp atomic
+					visited += (unsigned long)h * w;
+				}
+			}
+		}
+	}
+
+	alignment_score = B.get(rows - 1, cols - 1);
+
+	return visited;
+}
+
+// Recompute S after revise_sequences. Cell (i, j) depends on X[0..i) and Y[0..j) only, so the
+// block above first_row and left of first_col still holds the old scores; only the rows from
+// first_row and the columns from first_col are filled again. S must be allocated for the larger
+// of the old and new sizes and keep its old contents (no reset() in between).
+unsigned long SequenceInfo::gpsa_incremental(float **S, float **SUB, std::unordered_map<char, int> &cmap, int first_row, int first_col)
+{
+	unsigned long visited = 0;
+	gap_penalty = SUB[0][cmap['*']]; // min score
+	encode_sequences(cmap);
+	first_row = std::min(first_row, rows);
+	first_col = std::min(first_col, cols);
+
+	// Boundary, where it is new
+	for (int i = first_row; i < rows; i++)
+	{
+		S[i][0] = i * gap_penalty;
+		visited++;
+	}
+
+	for (int j = first_col; j < cols; j++)
+	{
+		S[0][j] = j * gap_penalty;
+		visited++;
+	}
+
+	const float *sub = SUB[0];
+	const int *x = X_codes.data(), *y = Y_codes.data();
+
+	// new columns of the kept rows, then the new rows in full
+	fill_tile(S, sub, SUB_size, x, y, gap_penalty, 1, first_row, std::max(first_col, 1), cols);
+	fill_tile(S, sub, SUB_size, x, y, gap_penalty, std::max(first_row, 1), rows, 1, cols);
+	visited += (unsigned long)(first_row - 1) * (cols - first_col) + (unsigned long)(rows - first_row) * (cols - 1);
+
+	return visited;
+}
+
+// Row by row fill of the whole S with the scoring of Scheme. Each row takes two passes: the
+// diagonal and up moves have no dependency along the row and are vectorized, then a scan adds the
+// left moves. max() is exact, so the result is the same as the one pass fill.
+template <typename Scheme>
+static void fill_specialized(float **S, const Scheme &scheme, const int *x, const int *y, int rows, int cols)
+{
+	std::vector<float> t(cols);
+	float *T = t.data();
+	const float gap = scheme.gap;
+
+	for (int i = 1; i < rows; i++)
+	{
+		const float *up = S[i - 1];
+		float *cur = S[i];
+		const int xi = x[i - 1];
+
+#pragma omp simd
+		for (int j = 1; j < cols; j++)
+			T[j] = std::max(up[j - 1] + scheme.score(xi, y[j - 1]), up[j] + gap);
+
+		float west = cur[0];
+		for (int j = 1; j < cols; j++)
+		{
+			west = std::max(T[j], west + gap);
+			cur[j] = west;
+		}
+	}
+}
+
+// Sequential fill with the scoring resolved at compile time when the loaded matrix is one of the
+// schemes in scoring.hpp, and through SUB otherwise. The kernel used is left in scoring_kernel.
+unsigned long SequenceInfo::gpsa_specialized(float **S, float **SUB, std::unordered_map<char, int> &cmap)
+{
+	unsigned long visited = 0;
+	gap_penalty = SUB[0][cmap['*']]; // min score
+	encode_sequences(cmap);
+
+	// Boundary
+	for (int i = 1; i < rows; i++)
+	{
+		S[i][0] = i * gap_penalty;
+		visited++;
+	}
+
+	for (int j = 0; j < cols; j++)
+	{
+		S[0][j] = j * gap_penalty;
+		visited++;
+	}
+
+	const int *x = X_codes.data(), *y = Y_codes.data();
+	if (scheme_matches<Blosum62Scoring>(SUB, SUB_size, cmap))
+	{
+		scoring_kernel = "blosum62";
+		fill_specialized(S, Blosum62Scoring(), x, y, rows, cols);
+	}
+	else if (scheme_matches<DnaScoring<1, -1, -2>>(SUB, SUB_size, cmap))
+	{
+		scoring_kernel = "dna";
+		fill_specialized(S, DnaScoring<1, -1, -2>(), x, y, rows, cols);
+	}
+	else
+	{
+		scoring_kernel = "runtime";
+		fill_specialized(S, RuntimeScoring{SUB[0], SUB_size, gap_penalty}, x, y, rows, cols);
+	}
+	visited += (unsigned long)(rows - 1) * (cols - 1);
+
+	return visited;
+}
+
+// Affine gap (Gotoh) versions. A gap of length k scores gap_open + (k - 1) * gap_extend:
+//   E[i][j] = max(H[i][j-1] + gap_open, E[i][j-1] + gap_extend)      left, gap in X
+//   F[i][j] = max(H[i-1][j] + gap_open, F[i-1][j] + gap_extend)      up, gap in Y
+//   H[i][j] = max(H[i-1][j-1] + SUB[x][y], E[i][j], F[i][j])
+// Row 0 and column 0 are one gap from (0, 0), with F (E) equal to H there so the traceback
+// follows them.
+static void affine_boundary(AffineMatrix &A, float gap_open, float gap_extend)
+{
+	const float neg_inf = -std::numeric_limits<float>::infinity();
+	A.row(0)[0] = {0, neg_inf, neg_inf};
+	for (int i = 1; i < A.rows; i++)
+	{
+		float h = gap_open + (i - 1) * gap_extend;
+		A.row(i)[0] = {h, neg_inf, h};
+	}
+	for (int j = 1; j < A.cols; j++)
+	{
+		float h = gap_open + (j - 1) * gap_extend;
+		A.row(0)[j] = {h, h, neg_inf};
+	}
+}
+
+// Row by row fill of the cells [i_begin..i_end) x [j_begin..j_end)
+static inline void affine_fill_tile(AffineMatrix &A, const float *sub, int sub_size, const int *x, const int *y, float gap_open, float gap_extend, int i_begin, int i_end, int j_begin, int j_end)
+{
+	for (int i = i_begin; i < i_end; i++)
+	{
+		const float *sub_row = sub + x[i - 1] * sub_size;
+		const AffineCell *up = A.row(i - 1);
+		AffineCell *cur = A.row(i);
+		for (int j = j_begin; j < j_end; j++)
+		{
+			float e = std::max(cur[j - 1].H + gap_open, cur[j - 1].E + gap_extend);
+			float f = std::max(up[j].H + gap_open, up[j].F + gap_extend);
+			float h = std::max({up[j - 1].H + sub_row[y[j - 1]], e, f});
+			cur[j] = {h, e, f};
+		}
+	}
+}
+
+unsigned long SequenceInfo::gpsa_affine(AffineMatrix &A, float **SUB, std::unordered_map<char, int> &cmap, float gap_open, float gap_extend)
+{
+	encode_sequences(cmap);
+	A.resize(rows, cols);
+	affine_boundary(A, gap_open, gap_extend);
+
+	affine_fill_tile(A, SUB[0], SUB_size, X_codes.data(), Y_codes.data(), gap_open, gap_extend, 1, rows, 1, cols);
+	alignment_score = A.get(rows - 1, cols - 1).H;
+
+	return (unsigned long)(rows - 1) * (cols - 1) + rows + cols - 1;
+}
+
+// Same task graph as gpsa_tiled: one task per tile, waiting for its north and west tiles
+unsigned long SequenceInfo::gpsa_affine_tiled(AffineMatrix &A, float **SUB, std::unordered_map<char, int> &cmap, float gap_open, float gap_extend, int tile_rows, int tile_cols)
+{
+	unsigned long visited = rows + cols - 1;
+	encode_sequences(cmap);
+	A.resize(rows, cols);
+	affine_boundary(A, gap_open, gap_extend);
+
+	int n_tr = (rows - 2) / tile_rows + 1, n_tc = (cols - 2) / tile_cols + 1;
+	std::vector<char> tile_done(n_tr * n_tc);
+	char *dep = tile_done.data();
+	const float *sub = SUB[0];
+	const int *x = X_codes.data(), *y = Y_codes.data();
+
+#pragma omp parallel
+#pragma omp single
+	{
+		for (int ti = 0; ti < n_tr; ti++)
+		{
+			for (int tj = 0; tj < n_tc; tj++)
+			{
+				[[maybe_unused]] char *north = ti > 0 ? &dep[(ti - 1) * n_tc + tj] : &dep[ti * n_tc + tj];
+				[[maybe_unused]] char *west = tj > 0 ? &dep[ti * n_tc + tj - 1] : &dep[ti * n_tc + tj];
+
+#pragma omp task firstprivate(ti, tj) depend(in : north[0], west[0]) depend(out : dep[ti * n_tc + tj])
+				{
+					int i_begin = 1 + ti * tile_rows, i_end = std::min(rows, i_begin + tile_rows);
+					int j_begin = 1 + tj * tile_cols, j_end = std::min(cols, j_begin + tile_cols);
+					GPSA_TRACE_TILE(ti, tj, omp_get_thread_num());
+
+					affine_fill_tile(A, sub, SUB_size, x, y, gap_open, gap_extend, i_begin, i_end, j_begin, j_end);
+
+#pragma omp atomic
+					visited += (unsigned long)(i_end - i_begin) * (j_end - j_begin);
+				}
+			}
+		}
+	}
+
+	alignment_score = A.get(rows - 1, cols - 1).H;
+
+	return visited;
+}
+
+// Two passes per row, as in fill_specialized: F and the diagonal move only read the row above
+// and are vectorized, then a scan along the row adds E.
+unsigned long SequenceInfo::gpsa_affine_simd(AffineMatrix &A, float **SUB, std::unordered_map<char, int> &cmap, float gap_open, float gap_extend)
+{
+	encode_sequences(cmap);
+	A.resize(rows, cols);
+	affine_boundary(A, gap_open, gap_extend);
+
+	std::vector<float> t(cols);
+	float *T = t.data();
+	const float *sub = SUB[0];
+	const int *x = X_codes.data(), *y = Y_codes.data();
+
+	for (int i = 1; i < rows; i++)
+	{
+		const float *sub_row = sub + x[i - 1] * SUB_size;
+		const AffineCell *up = A.row(i - 1);
+		AffineCell *cur = A.row(i);
+
+#pragma omp simd
+		for (int j = 1; j < cols; j++)
+		{
+			float f = std::max(up[j].H + gap_open, up[j].F + gap_extend);
+			cur[j].F = f;
+			T[j] = std::max(up[j - 1].H + sub_row[y[j - 1]], f);
+		}
+
+		float h = cur[0].H, e = cur[0].E;
+		for (int j = 1; j < cols; j++)
+		{
+			e = std::max(h + gap_open, e + gap_extend);
+			h = std::max(T[j], e);
+			cur[j].E = e;
+			cur[j].H = h;
+		}
+	}
+
+	alignment_score = A.get(rows - 1, cols - 1).H;
+
+	return (unsigned long)(rows - 1) * (cols - 1) + rows + cols - 1;
+}
+
+// Score plus moves: two rolling rows of scores, and the move into every cell packed in D.
+// The move is chosen with the same priority as traceback_and_save (diagonal, up, left), so the
+// traceback follows the same path without keeping S.
+unsigned long SequenceInfo::gpsa_directions(DirectionMatrix &D, float **SUB, std::unordered_map<char, int> &cmap)
+{
+	unsigned long visited = 0;
+	gap_penalty = SUB[0][cmap['*']]; // min score
+	encode_sequences(cmap);
+	D.resize(rows, cols);
+
+	std::vector<float> prev(cols), cur(cols);
+	const float *sub = SUB[0];
+
+	// Boundary
+	for (int j = 0; j < cols; j++)
+	{
+		prev[j] = j * gap_penalty;
+		visited++;
+	}
+	std::fill(D.row(0), D.row(0) + D.stride, (uint8_t)0xAA); // LEFT everywhere
+
+	for (int i = 1; i < rows; i++)
+	{
+		const float *sub_row = sub + X_codes[i - 1] * SUB_size;
+		uint8_t *dir = D.row(i);
+		uint8_t packed = DirectionMatrix::UP;
+
+		cur[0] = i * gap_penalty;
+		visited++;
+
+		for (int j = 1; j < cols; j++)
+		{
+			float match = prev[j - 1] + sub_row[Y_codes[j - 1]];
+			float del = prev[j] + gap_penalty;
+			float insert = cur[j - 1] + gap_penalty;
+			float best = std::max({match, del, insert});
+			int d = best == match ? DirectionMatrix::DIAG : best == del ? DirectionMatrix::UP : DirectionMatrix::LEFT;
+
+			cur[j] = best;
+			packed |= d << (2 * (j % 4));
+			if (j % 4 == 3)
+			{
+				dir[j / 4] = packed;
+				packed = 0;
+			}
+			visited++;
+		}
+		if (cols % 4)
+			dir[(cols - 1) / 4] = packed;
+
+		std::swap(prev, cur);
+	}
+
+	alignment_score = prev[cols - 1];
+
+	return visited;
+}
+
+// Score only, with O(cols) memory. The matrix is swept in bands of tile_rows rows; inside a band
+// every block of tile_cols columns is a task that updates its segment of a single rolling row in
+// place. Blocks pass their right-most column to the next block through an edge buffer, double
+// buffered by band parity, and the depend clauses order the row segments and the edge buffers,
+// so bands pipeline across threads.
+unsigned long SequenceInfo::gpsa_score_only(float **SUB, std::unordered_map<char, int> &cmap, int tile_rows, int tile_cols)
+{
+	unsigned long visited = 0;
+	gap_penalty = SUB[0][cmap['*']]; // min score
+	encode_sequences(cmap);
+
+	int n_bands = (rows - 2) / tile_rows + 1, n_blocks = (cols - 2) / tile_cols + 1;
+	std::vector<float> row(cols), edges(2 * n_blocks * (tile_rows + 1));
+	std::vector<char> row_dep(n_blocks), edge_dep(2 * n_blocks);
+	const float *sub = SUB[0];
+	const int *x = X_codes.data(), *y = Y_codes.data();
+	float *R = row.data();
+	char *rd = row_dep.data(), *ed = edge_dep.data();
+
+	// Boundary
+	for (int j = 0; j < cols; j++)
+		R[j] = j * gap_penalty;
+	visited = rows + cols - 1;
+
+#pragma omp parallel
+#pragma omp single
+	{
+		for (int b = 0; b < n_bands; b++)
+		{
+			for (int k = 0; k < n_blocks; k++)
+			{
+				int p = b % 2;
+				[[maybe_unused]] char *left_dep = k > 0 ? &ed[2 * (k - 1) + p] : &rd[k];
+
+#pragma omp task firstprivate(b, k, p) depend(inout : rd[k]) depend(in : left_dep[0]) depend(out : ed[2 * k + p])
+				{
+					int i_begin = 1 + b * tile_rows, i_end = std::min(rows, i_begin + tile_rows);
+					int j_begin = 1 + k * tile_cols, j_end = std::min(cols, j_begin + tile_cols);
+					const float *left = k > 0 ? &edges[(2 * (k - 1) + p) * (tile_rows + 1)] : nullptr;
+					float *edge = &edges[(2 * k + p) * (tile_rows + 1)];
+					GPSA_TRACE_TILE(b, k, omp_get_thread_num());
+
+					// corner above the band, before this block overwrites it
+					edge[0] = R[j_end - 1];
+					float diag = k > 0 ? left[0] : (i_begin - 1) * gap_penalty;
+
+					for (int i = i_begin; i < i_end; i++)
+					{
+						const float *sub_row = sub + x[i - 1] * SUB_size;
+						float west = k > 0 ? left[i - i_begin + 1] : i * gap_penalty;
+
+						for (int j = j_begin; j < j_end; j++)
+						{
+							float north = R[j];
+							float match = diag + sub_row[y[j - 1]];
+							float del = north + gap_penalty;
+							float insert = west + gap_penalty;
+							west = std::max({match, del, insert});
+							R[j] = west;
+							diag = north;
+						}
+						edge[i - i_begin + 1] = west;
+						diag = k > 0 ? left[i - i_begin + 1] : i * gap_penalty;
+					}
+
+#pragma omp atomic
+					visited += (unsigned long)(i_end - i_begin) * (j_end - j_begin);
+				}
+			}
+		}
+	}
+
+	alignment_score = R[cols - 1];
+
+	return visited;
+}
+
+// Upper bound on the score of any global path through (i, j). px[i] sums the best positive
+// substitution score of X[0..i) against any residue of Y (py likewise for Y), which bounds the
+// diagonal moves of a prefix ending in (i, j); the prefix also needs at least |i - j| gaps.
+// The suffix from (i, j) to (n, m) is bounded the same way.
+static float path_bound(int i, int j, const std::vector<float> &px, const std::vector<float> &py, float gap)
+{
+	int n = px.size() - 1, m = py.size() - 1;
+	float prefix = std::min(px[i], py[j]) + std::abs(i - j) * gap;
+	float suffix = std::min(px[n] - px[i], py[m] - py[j]) + std::abs((n - i) - (m - j)) * gap;
+	return prefix + suffix;
+}
+
+// One banded fill. With w >= 0 row i holds the cells within w of the diagonal from (0, 0) to
+// (rows-1, cols-1) (stretched to cover the next row's centre, so consecutive rows overlap).
+// With x_drop > 0, cells more than x_drop below the best cell of their row are pruned, and each
+// row only spans the live cells of the previous row plus the horizontal gaps that stay alive.
+static unsigned long banded_fill(BandedMatrix &B, const std::vector<int> &x, const std::vector<int> &y, const float *sub, int sub_size, float gap, int w, float x_drop)
+{
+	const float ninf = -std::numeric_limits<float>::infinity();
+	int n = x.size(), m = y.size();
+	unsigned long visited = 0;
+	std::vector<float> tmp;
+
+	auto centre = [&](int i) { return (int)std::min<long>(m, (long)i * m / std::max(n, 1)); };
+
+	B.clear();
+
+	// Row 0
+	int hi = w >= 0 ? std::min(m, centre(1) + w) : m;
+	if (x_drop > 0 && gap < 0)
+		hi = std::min(hi, (int)(x_drop / -gap));
+	float *row = B.add_row(0, hi);
+	for (int j = 0; j <= hi; j++)
+		row[j] = j * gap;
+	visited += hi + 1;
+
+	for (int i = 1; i <= n; i++)
+	{
+		int lo = w >= 0 ? std::max(0, centre(i) - w) : 0;
+		hi = w >= 0 ? std::min(m, centre(i + 1) + w) : m;
+		int prev_lo = B.lo[i - 1], prev_hi = B.hi[i - 1];
+
+		if (x_drop > 0)
+			lo = std::max(lo, prev_lo);
+
+		// Previous row is empty: x-drop gave up
+		if (prev_lo > prev_hi)
+		{
+			B.add_row(0, -1);
+			continue;
+		}
+
+		const float *sub_row = sub + x[i - 1] * sub_size;
+		float best = ninf;
+		tmp.clear();
+
+		for (int j = lo; j <= hi; j++)
+		{
+			float v;
+			if (j == 0)
+				v = i * gap;
+			else
+			{
+				float match = B.get(i - 1, j - 1) + sub_row[y[j - 1]];
+				float del = B.get(i - 1, j) + gap;
+				float insert = (j > lo ? tmp.back() : ninf) + gap;
+				v = std::max({match, del, insert});
+			}
+
+			// Past the previous row only horizontal gaps reach, stop once they drop out
+			if (x_drop > 0 && j > prev_hi + 1 && v < best - x_drop)
+				break;
+
+			tmp.push_back(v);
+			best = std::max(best, v);
+		}
+		visited += tmp.size();
+
+		int first = 0, last = (int)tmp.size() - 1;
+		if (x_drop > 0)
+		{
+			for (auto &v : tmp)
+				if (v < best - x_drop)
+					v = ninf;
+			while (first <= last && tmp[first] == ninf)
+				first++;
+			while (last >= first && tmp[last] == ninf)
+				last--;
+		}
+
+		row = B.add_row(lo + first, lo + last);
+		std::copy(tmp.begin() + first, tmp.begin() + last + 1, row);
+	}
+
+	return visited;
+}
+
+// Banded global alignment. band_width > 0 fixes the band, band_width == 0 without x-drop starts
+// narrow and doubles the band until it is proven optimal.
+// x_drop > 0 prunes cells by x-drop, inside the band if there is one. band_status reports whether
+// the band could have changed the optimum, so callers can fall back to the full algorithm.
+unsigned long SequenceInfo::gpsa_banded(BandedMatrix &B, float **SUB, std::unordered_map<char, int> &cmap, int band_width, float x_drop)
+{
+	unsigned long visited = 0;
+	gap_penalty = SUB[0][cmap['*']]; // min score
+	encode_sequences(cmap);
+
+	int n = rows - 1, m = cols - 1;
+	bool adaptive = band_width == 0 && x_drop <= 0;
+	int w = band_width > 0 ? band_width : (adaptive ? 32 : -1);
+
+	// Best positive substitution score of every residue against the other sequence, as prefix sums
+	std::vector<bool> in_x(SUB_size), in_y(SUB_size);
+	for (int c : X_codes) in_x[c] = true;
+	for (int c : Y_codes) in_y[c] = true;
+	std::vector<float> best_vs_y(SUB_size, 0), best_vs_x(SUB_size, 0);
+	for (int a = 0; a < SUB_size; a++)
+		for (int b = 0; b < SUB_size; b++)
+		{
+			if (in_y[b]) best_vs_y[a] = std::max(best_vs_y[a], SUB[a][b]);
+			if (in_x[b]) best_vs_x[a] = std::max(best_vs_x[a], SUB[b][a]);
+		}
+	std::vector<float> px(n + 1, 0), py(m + 1, 0);
+	for (int i = 0; i < n; i++)
+		px[i + 1] = px[i] + best_vs_y[X_codes[i]];
+	for (int j = 0; j < m; j++)
+		py[j + 1] = py[j] + best_vs_x[Y_codes[j]];
+
+	while (true)
+	{
+		visited += banded_fill(B, X_codes, Y_codes, SUB[0], SUB_size, gap_penalty, w, x_drop);
+
+		band_status = BandStatus();
+		band_status.width = std::max(w, 0);
+		band_status.reached_end = B.get(n, m) > -std::numeric_limits<float>::infinity();
+
+		if (band_status.reached_end)
+		{
+			float score = B.get(n, m);
+
+			// Walk the traceback path and look for predecessors outside the band
+			int i = n, j = m;
+			while (i > 0 || j > 0)
+			{
+				if (i > 0 && j > 0 && (j - 1 < B.lo[i - 1] || j > B.hi[i - 1] || j - 1 < B.lo[i]))
+					band_status.touched_edge = true;
+
+				float s = B.get(i, j);
+				if (i > 0 && j > 0 && s == B.get(i - 1, j - 1) + SUB[X_codes[i - 1]][Y_codes[j - 1]])
+				{
+					i--; j--;
+				}
+				else if (i > 0 && s == B.get(i - 1, j) + gap_penalty)
+					i--;
+				else
+					j--;
+			}
+
+			// Every path leaving a fixed band passes a cell right next to it
+			band_status.proven_optimal = x_drop <= 0 && gap_penalty <= 0;
+			for (i = 0; i <= n && band_status.proven_optimal; i++)
+			{
+				if (B.lo[i] > 0 && path_bound(i, B.lo[i] - 1, px, py, gap_penalty) > score)
+					band_status.proven_optimal = false;
+				if (B.hi[i] < m && path_bound(i, B.hi[i] + 1, px, py, gap_penalty) > score)
+					band_status.proven_optimal = false;
+			}
+
+			alignment_score = score;
+		}
+
+		if (!adaptive || band_status.proven_optimal || w >= std::max(n, m))
+			break;
+		w *= 2;
+	}
+
+	return visited;
+}
+
+// Batch kernel: L pairs at once, one per lane. Scores and moves are stored lane-interleaved,
+// so the lane loop of every cell is a plain vector operation. Lanes of shorter pairs compute
+// padding past their own end, which never feeds back into their cells. Moves use the same
+// diagonal/up/left priority as traceback_and_save.
+template <int L>
+static void batch_kernel(const std::vector<const FastaRecord *> &xs, const std::vector<const FastaRecord *> &ys, const float *sub, int sub_size, float gap, PairResult *out)
+{
+	int n = xs.size(), R = 1, C = 1;
+	for (int l = 0; l < n; l++)
+	{
+		R = std::max(R, (int)xs[l]->codes.size() + 1);
+		C = std::max(C, (int)ys[l]->codes.size() + 1);
+	}
+
+	// Lane-interleaved residues, already offset into the substitution matrix for X
+	std::vector<int> xc((R - 1) * L, 0), yc((C - 1) * L, 0);
+	for (int l = 0; l < n; l++)
+	{
+		for (unsigned int i = 0; i < xs[l]->codes.size(); i++)
+			xc[i * L + l] = xs[l]->codes[i] * sub_size;
+		for (unsigned int j = 0; j < ys[l]->codes.size(); j++)
+			yc[j * L + l] = ys[l]->codes[j];
+	}
+
+	std::vector<float> prev(C * L), cur(C * L);
+	std::vector<uint8_t> dir((size_t)R * C * L);
+
+	for (int j = 0; j < C; j++)
+		for (int l = 0; l < L; l++)
+		{
+			prev[j * L + l] = j * gap;
+			dir[j * L + l] = DirectionMatrix::LEFT;
+		}
+
+	for (int i = 1; i < R; i++)
+	{
+		const int *x = &xc[(i - 1) * L];
+		uint8_t *d = &dir[(size_t)i * C * L];
+
+		for (int l = 0; l < L; l++)
+		{
+			cur[l] = i * gap;
+			d[l] = DirectionMatrix::UP;
+		}
+
+		for (int j = 1; j < C; j++)
+		{
+			const int *y = &yc[(j - 1) * L];
+#pragma omp simd
+			for (int l = 0; l < L; l++)
+			{
+				float match = prev[(j - 1) * L + l] + sub[x[l] + y[l]];
+				float del = prev[j * L + l] + gap;
+				float insert = cur[(j - 1) * L + l] + gap;
+				float best = std::max(match, std::max(del, insert));
+				cur[j * L + l] = best;
+				d[j * L + l] = best == match ? DirectionMatrix::DIAG : (best == del ? DirectionMatrix::UP : DirectionMatrix::LEFT);
+			}
+		}
+		std::swap(prev, cur);
+	}
+
+	// Traceback statistics per lane
+	for (int l = 0; l < n; l++)
+	{
+		const std::vector<int> &a = xs[l]->codes, &b = ys[l]->codes;
+		PairResult &r = out[l];
+		int i = a.size(), j = b.size();
+
+		while (i > 0 || j > 0)
+		{
+			int m = dir[((size_t)i * C + j) * L + l];
+			if (m == DirectionMatrix::DIAG)
+			{
+				float s = sub[a[i - 1] * sub_size + b[j - 1]];
+				r.score += s;
+				if (s > 0)
+				{
+					r.similarity_score++;
+					if (a[i - 1] == b[j - 1])
+						r.identity_score++;
+				}
+				i--; j--;
+			}
+			else
+			{
+				r.score += gap;
+				r.gap_count++;
+				if (m == DirectionMatrix::UP)
+					i--;
+				else
+					j--;
+			}
+			r.length++;
+		}
+	}
+}
+
+// A long pair of the batch, with the Hirschberg recursion of gpsa_hirschberg: linear space, and
+// its halves become tasks of the enclosing parallel region. Called from inside a task.
+static void batch_long(const FastaRecord &q, const FastaRecord &t, const float *sub, int sub_size, float gap, PairResult &r)
+{
+	const std::vector<int> &a = q.codes, &b = t.codes;
+	int rows = a.size() + 1, cols = b.size() + 1;
+	HirschbergContext ctx = {a.data(), b.data(), sub, sub_size, gap, 1 << 14, 1 << 20, 0};
+
+	std::vector<float> T(cols), L(rows);
+	for (int j = 0; j < cols; j++)
+		T[j] = j * gap;
+	for (int i = 0; i < rows; i++)
+		L[i] = i * gap;
+
+	std::string moves;
+	int i, j;
+	hirschberg_solve(ctx, 0, 0, T, L, moves, i, j);
+	moves.append(i, 'U');
+	moves.append(j, 'L');
+
+	// moves run from the end of the path, only the statistics are kept
+	i = rows - 1;
+	j = cols - 1;
+	for (char m : moves)
+	{
+		if (m == 'D')
+		{
+			float s = sub[a[i - 1] * sub_size + b[j - 1]];
+			r.score += s;
+			if (s > 0)
+			{
+				r.similarity_score++;
+				if (a[i - 1] == b[j - 1])
+					r.identity_score++;
+			}
+			i--; j--;
+		}
+		else
+		{
+			r.score += gap;
+			r.gap_count++;
+			if (m == 'U')
+				i--;
+			else
+				j--;
+		}
+	}
+	r.length = moves.size();
+}
+
+// Aligns every listed (query, target) pair. Short pairs are sorted by size and packed eight at
+// a time into the lanes of batch_kernel. Long pairs (more than lane_cells cells) would need a
+// move byte per cell there, they go to batch_long instead, which splits each of them into tasks.
+// One task per job, largest first, so the long pairs start early and the short jobs fill in.
+std::vector<PairResult> batch_align(const std::vector<FastaRecord> &queries, const std::vector<FastaRecord> &targets, const std::vector<std::pair<int, int>> &pairs, float **SUB, int sub_size, float gap_penalty, long lane_cells = 1 << 18)
+{
+	const int lanes = 8;
+	auto cells = [&](int k) { return (long)(queries[pairs[k].first].codes.size() + 1) * (long)(targets[pairs[k].second].codes.size() + 1); };
+
+	std::vector<int> order(pairs.size());
+	for (unsigned int k = 0; k < pairs.size(); k++)
+		order[k] = k;
+	std::sort(order.begin(), order.end(), [&](int a, int b) { return cells(a) > cells(b); });
+
+	// A job is a range of order: a single long pair or up to eight short ones
+	std::vector<std::pair<int, int>> jobs;
+	for (unsigned int k = 0; k < order.size();)
+	{
+		int len = cells(order[k]) > lane_cells ? 1 : std::min<int>(lanes, order.size() - k);
+		jobs.emplace_back(k, len);
+		k += len;
+	}
+
+	std::vector<PairResult> results(pairs.size());
+
+#pragma omp parallel
+#pragma omp single
+	for (unsigned int t = 0; t < jobs.size(); t++)
+	{
+#pragma omp task firstprivate(t)
+		{
+			std::vector<const FastaRecord *> xs, ys;
+			std::vector<PairResult> out(jobs[t].second);
+			for (int k = 0; k < jobs[t].second; k++)
+			{
+				const std::pair<int, int> &p = pairs[order[jobs[t].first + k]];
+				xs.push_back(&queries[p.first]);
+				ys.push_back(&targets[p.second]);
+				out[k].query = p.first;
+				out[k].target = p.second;
+			}
+
+			if (cells(order[jobs[t].first]) > lane_cells)
+				batch_long(*xs[0], *ys[0], SUB[0], sub_size, gap_penalty, out[0]);
+			else
+				batch_kernel<lanes>(xs, ys, SUB[0], sub_size, gap_penalty, out.data());
+
+			for (int k = 0; k < jobs[t].second; k++)
+				results[order[jobs[t].first + k]] = out[k];
+		}
+	}
+
+	return results;
+}
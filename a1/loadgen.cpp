@@ -0,0 +1,173 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <map>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Load generator for gpsa-server. --connections clients each keep up to --depth requests in flight
+// (a new one goes out whenever an answer comes back) until --requests are answered in total. The
+// pairs are random sequences with lengths picked from --sizes. Prints the throughput (requests/s
+// and GCUPS) and the latency percentiles, overall and per length.
+
+using Clock = std::chrono::steady_clock;
+
+struct Sample {
+    int length;
+    double latency; // seconds from sending the request to reading its answer
+    bool ok;
+};
+
+std::vector<int> parse_list(const std::string& s) {
+    std::vector<int> v;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        v.push_back(std::stoi(item));
+    return v;
+}
+
+double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+// One connection: sends its share of the requests with at most depth in flight
+void client(const std::string& socket_path, int first_id, int n_requests, int depth, const std::vector<int>& sizes,
+            const std::string& command, const std::string& matrix, const std::string& residues, unsigned seed, std::vector<Sample>& samples) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        std::cerr << "[error]: cannot connect to " << socket_path << ": " << strerror(errno) << std::endl;
+        exit(-1);
+    }
+
+    std::mt19937 rng(seed);
+    auto random_sequence = [&](int length) {
+        std::string s(length, ' ');
+        for (auto& c: s) c = residues[rng() % residues.size()];
+        return s;
+    };
+
+    std::map<int, std::pair<int, Clock::time_point>> in_flight; // id -> (length, sent)
+    int sent = 0, answered = 0;
+    auto send_next = [&]() {
+        int length = sizes[rng() % sizes.size()];
+        int id = first_id + sent++;
+        std::string line = command + " " + std::to_string(id) + " " + random_sequence(length) + " " + random_sequence(length) + " " + matrix + "\n";
+        in_flight[id] = {length, Clock::now()};
+        for (size_t done = 0; done < line.size();) {
+            ssize_t n = write(fd, line.data() + done, line.size() - done);
+            if (n <= 0) {
+                std::cerr << "[error]: connection lost" << std::endl;
+                exit(-1);
+            }
+            done += n;
+        }
+    };
+
+    while (sent < n_requests && sent < depth)
+        send_next();
+
+    std::string buffer, line;
+    char chunk[1 << 16];
+    while (answered < n_requests) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) {
+            std::cerr << "[error]: connection closed with " << n_requests - answered << " requests unanswered" << std::endl;
+            exit(-1);
+        }
+        buffer.append(chunk, n);
+        size_t nl;
+        while ((nl = buffer.find('\n')) != std::string::npos) {
+            line = buffer.substr(0, nl);
+            buffer.erase(0, nl + 1);
+            std::stringstream ss(line);
+            int id;
+            std::string status;
+            ss >> id >> status;
+            auto it = in_flight.find(id);
+            if (it == in_flight.end()) continue;
+            samples.push_back({it->second.first, std::chrono::duration<double>(Clock::now() - it->second.second).count(), status == "ok"});
+            in_flight.erase(it);
+            answered++;
+            if (sent < n_requests) send_next();
+        }
+    }
+    close(fd);
+}
+
+int main(int argc, char **argv)
+{
+    std::string socket_path = "gpsa.sock", command = "align", matrix = "", residues = "ARNDCQEGHILKMFPSTWYV";
+    int n_requests = 1000, n_connections = 4, depth = 8;
+    std::vector<int> sizes = {100, 1000};
+    unsigned seed = 1;
+    std::string usage("Usage: --socket <path> --requests <n> --connections <n> --depth <n> --sizes <l1,l2,...> --score-only --matrix <name> --residues <letters> --seed <n>");
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg != "--score-only" && i + 1 >= argc) arg = "--help";
+        if (arg == "--score-only") command = "score";
+        else if (arg == "--socket") socket_path = argv[++i];
+        else if (arg == "--requests") n_requests = std::stoi(argv[++i]);
+        else if (arg == "--connections") n_connections = std::stoi(argv[++i]);
+        else if (arg == "--depth") depth = std::stoi(argv[++i]);
+        else if (arg == "--sizes") sizes = parse_list(argv[++i]);
+        else if (arg == "--matrix") matrix = argv[++i];
+        else if (arg == "--residues") residues = argv[++i];
+        else if (arg == "--seed") seed = std::stoul(argv[++i]);
+        else {
+            std::cerr << usage << std::endl;
+            exit(-1);
+        }
+    }
+
+    std::vector<std::vector<Sample>> samples(n_connections);
+    std::vector<std::thread> clients;
+    auto t_start = Clock::now();
+    for (int c = 0, first_id = 0; c < n_connections; ++c) {
+        int share = n_requests / n_connections + (c < n_requests % n_connections ? 1 : 0);
+        clients.emplace_back(client, socket_path, first_id, share, depth, std::cref(sizes), command, matrix, residues, seed + c, std::ref(samples[c]));
+        first_id += share;
+    }
+    for (auto& t: clients)
+        t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - t_start).count();
+
+    // overall, then per length
+    std::map<int, std::vector<double>> by_length;
+    std::vector<double> all;
+    int errors = 0;
+    double cells = 0;
+    for (auto& s: samples)
+        for (auto& x: s) {
+            all.push_back(x.latency);
+            by_length[x.length].push_back(x.latency);
+            errors += !x.ok;
+            cells += (double)(x.length + 1) * (x.length + 1);
+        }
+
+    std::cout << "Requests: " << all.size() << " (" << errors << " errors) over " << n_connections << " connections, depth " << depth << ", in " << elapsed << " seconds" << std::endl;
+    std::cout << "Throughput: " << all.size() / elapsed << " requests/s, " << cells / elapsed / 1e9 << " GCUPS" << std::endl;
+    auto print = [](const std::string& name, std::vector<double>& v) {
+        double mean = 0;
+        for (double x: v) mean += x;
+        mean /= std::max<size_t>(1, v.size());
+        std::cout << name << ": " << v.size() << " requests, latency (ms) mean " << mean * 1e3 << ", p50 " << percentile(v, 0.5) * 1e3
+                  << ", p95 " << percentile(v, 0.95) * 1e3 << ", p99 " << percentile(v, 0.99) * 1e3 << ", max " << percentile(v, 1) * 1e3 << std::endl;
+    };
+    print("All", all);
+    for (auto& [length, v]: by_length)
+        print("Length " + std::to_string(length), v);
+
+    return 0;
+}
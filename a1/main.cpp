@@ -3,23 +3,102 @@
 #include <functional>
 #include "helpers.hpp"
 #include "implementation.hpp"
+#include "engine.hpp"
 
 int main(int argc, char **argv)
 {
     bool print_runtime_only = false;
-    int exec_mode = 0; // 0. all, 1 sequential only, 2. taskloop only, 3. explicit tasks only
+    int exec_mode = 0; // 0. all, 1 sequential only, 2. taskloop only, 3. explicit tasks only, 4. hirschberg (linear space) only, 5. anti-diagonal simd only, 6. striped integer simd only, 7. tiled tasks with dependencies only, 8. work-stealing std::thread only, 9. score plus 2-bit directions only, 10. score only, 11. banded / x-drop only, 12. tile-major layout only, 13. incremental re-alignment only, 14. compile-time specialized scoring only, 15. affine gap only, 16. affine gap tiled only, 17. affine gap simd only, 18. alignment engine only
     int grain_size = 1; // optional parameter to use for adjusting task granularity 
+    int tile_rows = 256, tile_cols = 256; // tile size of the tiled versions
+    int band_width = 0; // banded version: 0 adapts the band width
+    float x_drop = 0; // banded version: x-drop threshold, 0 disables it
+    bool batch = false; // batch mode: X and Y are multi-record FASTA files
+    std::string pairs_filename = ""; // batch mode: pairs to align, all against all if empty
+    const size_t batch_chunk = 4096; // batch mode: targets read at a time when streaming
+    bool numa = false; // pin threads and place row blocks of S on the node of the thread owning them
+    bool huge_pages = false; // with numa: explicit 2 MB huge pages instead of transparent ones
+    std::string revised_X_filename = "", revised_Y_filename = ""; // incremental version: revised X and/or Y
+    float gap_open = -11, gap_extend = -1; // affine gap versions: first and further positions of a gap
 	std::string X_filename = "X.txt", Y_filename = "Y.txt", output_filename = "aligned-sequential.txt";
 	std::string substitution_matrix_file = "blosum62.txt";
-	parse_args(argc, argv, X_filename, Y_filename, output_filename, grain_size, exec_mode, print_runtime_only);
+	parse_args(argc, argv, X_filename, Y_filename, output_filename, grain_size, exec_mode, print_runtime_only, tile_rows, tile_cols, band_width, x_drop, batch, pairs_filename, numa, huge_pages, revised_X_filename, revised_Y_filename, gap_open, gap_extend);
     unsigned long entries_visited = 0, entries_visited_sequential = 0;
+    float score_sequential = 0;
+
+    // batch mode: every query in X against every target in Y, one line per pair
+    if (batch) {
+        SequenceInfo binfo;
+        std::unordered_map<char, int> cmap;
+        float** SUB = binfo.substitution_matrix_from_file(substitution_matrix_file, cmap);
+        float gap_penalty = SUB[0][cmap['*']];
+
+        std::vector<FastaRecord> queries = load_fasta(X_filename, cmap), targets;
+        std::vector<std::pair<int, int>> pairs;
+        size_t n_pairs = 0;
+        double cells = 0, seconds = 0;
+
+        // Listed pairs need every target up front, otherwise targets are streamed in chunks
+        FastaReader target_reader(Y_filename, &cmap);
+        FastaRecord rec;
+        bool more = true;
+        if (!pairs_filename.empty()) {
+            targets = load_fasta(Y_filename, cmap);
+            pairs = load_pairs(pairs_filename, queries, targets);
+            more = false;
+        }
+
+        std::cout << "# query target score similarity identity gaps length" << std::endl;
+        do {
+            if (pairs_filename.empty()) {
+                targets.clear();
+                while (targets.size() < batch_chunk && (more = target_reader.next(rec)))
+                    targets.push_back(rec);
+                pairs.clear();
+                for (unsigned int q = 0; q < queries.size(); ++q)
+                    for (unsigned int t = 0; t < targets.size(); ++t)
+                        pairs.emplace_back(q, t);
+            }
+
+            auto t_batch_1 = std::chrono::high_resolution_clock::now();
+
+            std::vector<PairResult> results = batch_align(queries, targets, pairs, SUB, binfo.SUB_size, gap_penalty);
+
+            auto t_batch_2 = std::chrono::high_resolution_clock::now();
+            seconds += std::chrono::duration<double>(t_batch_2 - t_batch_1).count();
+
+            for (auto& r: results) {
+                std::cout << queries[r.query].name << " " << targets[r.target].name << " " << r.score << " " << r.similarity_score << " " << r.identity_score << " " << r.gap_count << " " << r.length << "\n";
+                cells += (double)queries[r.query].seq.size() * targets[r.target].seq.size();
+            }
+            n_pairs += results.size();
+        } while (more);
+
+        std::cerr << "== Batch of " << n_pairs << " pairs completed in " << seconds << " seconds, GCUPS: " << cells / seconds / 1e9 << std::endl;
+
+        deallocate(SUB);
+        return 0;
+    }
 
     SequenceInfo sinfo(X_filename, Y_filename);
     std::cout << "Loaded X and Y sequences with sizes " << sinfo.rows -1  << " and " << sinfo.cols -1 << std::endl;
     std::cout << "Matrix S size: [" << sinfo.rows << "x" << sinfo.cols << "]" << std::endl;
 
-    // allocate
-    float** S = allocate(sinfo.rows,sinfo.cols, 0); // Similarity Matrix
+    // allocate (the linear space modes do not need the full matrix)
+    bool needs_matrix = exec_mode != 4 && exec_mode != 9 && exec_mode != 10 && exec_mode != 11 && exec_mode != 12 && exec_mode != 13 && exec_mode < 15 && exec_mode != 18;
+    NumaLayout layout;
+    float** S = nullptr; // Similarity Matrix
+    if (numa) {
+        layout = NumaLayout::detect(omp_get_max_threads());
+        pin_omp_threads(layout);
+        std::cout << "NUMA: " << omp_get_max_threads() << " threads pinned over " << layout.n_nodes << " node(s)" << std::endl;
+    }
+    if (needs_matrix && numa) {
+        S = allocate_numa(sinfo.rows, sinfo.cols, 0, tile_rows, huge_pages);
+        std::cout << "Matrix S on " << (huge_pages ? "explicit" : "transparent") << " huge pages, first touched in blocks of " << tile_rows << " rows" << std::endl;
+    }
+    else if (needs_matrix)
+        S = allocate(sinfo.rows,sinfo.cols, 0);
 
     std::unordered_map<char, int> cmap; // map Amino Acid (a character) to an index in Substitution Matrix
 
@@ -36,27 +115,33 @@ int main(int argc, char **argv)
         auto t_seq_2 = std::chrono::high_resolution_clock::now();
         
         sinfo.traceback_and_save(output_filename, S, SUB, cmap, false);
+        score_sequential = S[sinfo.rows-1][sinfo.cols-1];
         std::cout << "\n== Sequential version completed in " << std::chrono::duration<float>(t_seq_2 - t_seq_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_seq_2 - t_seq_1).count()) << std::endl; 
         std::cout << "   Entries visited: " << entries_visited_sequential << " " << (expected_visited ? "" : "NOT OK") << std::endl; 
         std::cout << "   Score: " << S[sinfo.rows-1][sinfo.cols-1] << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
-        sinfo.reset(S);
+        sinfo.reset();
     }
     
     // taskloop version
     if ( exec_mode == 2 || exec_mode < 1) {
+        GPSA_TRACE_BEGIN();
         auto t_taskloop_1 = std::chrono::high_resolution_clock::now();
 
         entries_visited = sinfo.gpsa_taskloop(S, SUB, cmap, grain_size);
         
         auto t_taskloop_2 = std::chrono::high_resolution_clock::now();
+        GPSA_TRACE_END();
         
         sinfo.traceback_and_save("aligned-taskloop.txt", S, SUB, cmap);
 
         std::cout << "\n== Taskloop version completed in " << std::chrono::duration<float>(t_taskloop_2 - t_taskloop_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_taskloop_2 - t_taskloop_1).count()) << std::endl; 
         std::cout << "   Entries visited: " << entries_visited << " " << (expected_visited == entries_visited ? "" : "NOT OK") << std::endl; 
         std::cout << "   Score: " << S[sinfo.rows-1][sinfo.cols-1] << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
         if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-taskloop.txt") ? "OK" : "NOT OK") << std::endl;
-        sinfo.reset(S);
+        GPSA_TRACE_REPORT("trace-taskloop.json");
+        sinfo.reset();
     }
 
     // explicit tasks versions
@@ -71,12 +156,358 @@ int main(int argc, char **argv)
         sinfo.traceback_and_save("aligned-tasks.txt", S, SUB, cmap);  
         
         std::cout << "\n== Explicit Tasks version completed in " << std::chrono::duration<float>(t_tasks_2 - t_tasks_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_tasks_2 - t_tasks_1).count()) << std::endl; 
         std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
         std::cout << "   Score: " << S[sinfo.rows-1][sinfo.cols-1] << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
         if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-tasks.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    // hirschberg (linear space) version
+    if ( exec_mode == 4 || exec_mode < 1) {
+        auto t_hirschberg_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_hirschberg(SUB, cmap);
+
+        auto t_hirschberg_2 = std::chrono::high_resolution_clock::now();
+
+        sinfo.save_alignment("aligned-hirschberg.txt");
+
+        std::cout << "\n== Hirschberg version completed in " << std::chrono::duration<float>(t_hirschberg_2 - t_hirschberg_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_hirschberg_2 - t_hirschberg_1).count()) << std::endl; 
+        std::cout << "   Entries computed: " << entries_visited << " (recomputation included)" << std::endl; 
+        std::cout << "   Score: " << sinfo.alignment_score << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-hirschberg.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    // anti-diagonal simd version
+    if ( exec_mode == 5 || exec_mode < 1) {
+        auto t_simd_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_simd(S, SUB, cmap);
+
+        auto t_simd_2 = std::chrono::high_resolution_clock::now();
+
+        sinfo.traceback_and_save("aligned-simd.txt", S, SUB, cmap);
+
+        std::cout << "\n== Anti-diagonal SIMD version completed in " << std::chrono::duration<float>(t_simd_2 - t_simd_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_simd_2 - t_simd_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << S[sinfo.rows-1][sinfo.cols-1] << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-simd.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    // striped integer simd version
+    if ( exec_mode == 6 || exec_mode < 1) {
+        auto t_striped_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_striped(S, SUB, cmap);
+
+        auto t_striped_2 = std::chrono::high_resolution_clock::now();
+
+        sinfo.traceback_and_save("aligned-striped.txt", S, SUB, cmap);
+
+        std::cout << "\n== Striped SIMD version (" << sinfo.score_bits << "-bit scores) completed in " << std::chrono::duration<float>(t_striped_2 - t_striped_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_striped_2 - t_striped_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << S[sinfo.rows-1][sinfo.cols-1] << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-striped.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    // tiled tasks with dependencies version
+    if ( exec_mode == 7 || exec_mode < 1) {
+        GPSA_TRACE_BEGIN();
+        auto t_tiled_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_tiled(S, SUB, cmap, tile_rows, tile_cols);
+
+        auto t_tiled_2 = std::chrono::high_resolution_clock::now();
+        GPSA_TRACE_END();
+
+        sinfo.traceback_and_save("aligned-tiled.txt", S, SUB, cmap);
+
+        std::cout << "\n== Tiled Tasks version (" << tile_rows << "x" << tile_cols << " tiles) completed in " << std::chrono::duration<float>(t_tiled_2 - t_tiled_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_tiled_2 - t_tiled_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << S[sinfo.rows-1][sinfo.cols-1] << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-tiled.txt") ? "OK" : "NOT OK") << std::endl;
+        GPSA_TRACE_REPORT("trace-tiled.json");
+        sinfo.reset();
+    }
+
+    // work-stealing std::thread version
+    if ( exec_mode == 8 || exec_mode < 1) {
+        int n_threads = omp_get_max_threads(); // follow OMP_NUM_THREADS, so runall.sh covers it too
+        GPSA_TRACE_BEGIN();
+        auto t_ws_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_work_stealing(S, SUB, cmap, tile_rows, tile_cols, n_threads, numa ? &layout : nullptr);
+
+        auto t_ws_2 = std::chrono::high_resolution_clock::now();
+        GPSA_TRACE_END();
+
+        sinfo.traceback_and_save("aligned-work-stealing.txt", S, SUB, cmap);
+
+        std::cout << "\n== Work-Stealing version (" << n_threads << " threads, " << tile_rows << "x" << tile_cols << " tiles) completed in " << std::chrono::duration<float>(t_ws_2 - t_ws_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_ws_2 - t_ws_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << S[sinfo.rows-1][sinfo.cols-1] << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-work-stealing.txt") ? "OK" : "NOT OK") << std::endl;
+        GPSA_TRACE_REPORT("trace-work-stealing.json");
+        sinfo.reset();
+    }
+
+    // score plus 2-bit directions version
+    if ( exec_mode == 9 || exec_mode < 1) {
+        DirectionMatrix D;
+        auto t_dir_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_directions(D, SUB, cmap);
+
+        auto t_dir_2 = std::chrono::high_resolution_clock::now();
+
+        sinfo.traceback_directions_and_save("aligned-directions.txt", D, SUB, cmap);
+
+        std::cout << "\n== Directions version completed in " << std::chrono::duration<float>(t_dir_2 - t_dir_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_dir_2 - t_dir_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << sinfo.alignment_score << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-directions.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    // score only version, no traceback and no output file
+    if ( exec_mode == 10 || exec_mode < 1) {
+        GPSA_TRACE_BEGIN();
+        auto t_score_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_score_only(SUB, cmap, tile_rows, tile_cols);
+
+        auto t_score_2 = std::chrono::high_resolution_clock::now();
+        GPSA_TRACE_END();
+
+        std::cout << "\n== Score Only version (" << tile_rows << "x" << tile_cols << " tiles) completed in " << std::chrono::duration<float>(t_score_2 - t_score_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_score_2 - t_score_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << sinfo.alignment_score << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.alignment_score == score_sequential ? "OK" : "NOT OK") << std::endl;
+        GPSA_TRACE_REPORT("trace-score-only.json");
+        sinfo.reset();
+    }
+
+    // banded / x-drop version
+    if ( exec_mode == 11 || exec_mode < 1) {
+        BandedMatrix B;
+        auto t_band_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_banded(B, SUB, cmap, band_width, x_drop);
+
+        auto t_band_2 = std::chrono::high_resolution_clock::now();
+
+        BandStatus status = sinfo.band_status;
+        std::cout << "\n== Banded version (width " << status.width << ", x-drop " << x_drop << ") completed in " << std::chrono::duration<float>(t_band_2 - t_band_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_band_2 - t_band_1).count()) << std::endl; 
+        std::cout << "   Entries computed: " << entries_visited << std::endl; 
+        if (status.reached_end) {
+            sinfo.traceback_and_save("aligned-banded.txt", B, SUB, cmap);
+            std::cout << "   Score: " << sinfo.alignment_score << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        }
+        std::cout << "   Band: " << (!status.reached_end ? "end not reached, use the full algorithm" : status.proven_optimal ? "optimal (proven)" : status.touched_edge ? "may be suboptimal, path touches the band edge, use the full algorithm" : "path clear of the band edge, optimum not proven") << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-banded.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    // tile-major layout version
+    if ( exec_mode == 12 || exec_mode < 1) {
+        BlockedMatrix B;
+        B.resize(sinfo.rows, sinfo.cols, tile_rows, tile_cols); // allocated up front, like S
+        GPSA_TRACE_BEGIN();
+        auto t_blocked_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_blocked(B, SUB, cmap, tile_rows, tile_cols);
+
+        auto t_blocked_2 = std::chrono::high_resolution_clock::now();
+        GPSA_TRACE_END();
+
+        sinfo.traceback_and_save("aligned-blocked.txt", B, SUB, cmap);
+
+        std::cout << "\n== Blocked Layout version (" << tile_rows << "x" << tile_cols << " tiles) completed in " << std::chrono::duration<float>(t_blocked_2 - t_blocked_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_blocked_2 - t_blocked_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << sinfo.alignment_score << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-blocked.txt") ? "OK" : "NOT OK") << std::endl;
+        GPSA_TRACE_REPORT("trace-blocked.json");
+        sinfo.reset();
+    }
+
+    // compile-time specialized scoring version
+    if ( exec_mode == 14 || exec_mode < 1) {
+        auto t_spec_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_specialized(S, SUB, cmap);
+
+        auto t_spec_2 = std::chrono::high_resolution_clock::now();
+
+        sinfo.traceback_and_save("aligned-specialized.txt", S, SUB, cmap);
+
+        std::cout << "\n== Specialized Scoring version (" << sinfo.scoring_kernel << " kernel) completed in " << std::chrono::duration<float>(t_spec_2 - t_spec_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_spec_2 - t_spec_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << S[sinfo.rows-1][sinfo.cols-1] << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-specialized.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    // affine gap (Gotoh) versions, H/E/F interleaved per cell. Nothing after this point uses S,
+    // and A is three times its size, so S goes first when all versions run
+    if (S && numa) deallocate_numa(S, sinfo.rows, sinfo.cols);
+    else if (S) deallocate(S);
+    S = nullptr;
+
+    if ( exec_mode == 15 || exec_mode < 1) {
+        AffineMatrix A;
+        A.resize(sinfo.rows, sinfo.cols); // allocated up front, like S
+        auto t_affine_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_affine(A, SUB, cmap, gap_open, gap_extend);
+
+        auto t_affine_2 = std::chrono::high_resolution_clock::now();
+
+        sinfo.traceback_affine_and_save("aligned-affine.txt", A, SUB, cmap, gap_open);
+
+        std::cout << "\n== Affine Gap version (gap open " << gap_open << ", extend " << gap_extend << ") completed in " << std::chrono::duration<float>(t_affine_2 - t_affine_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_affine_2 - t_affine_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << sinfo.alignment_score << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        // comparable with the linear versions only when both penalties are the linear one
+        if ( exec_mode < 1 && gap_open == gap_extend && gap_open == sinfo.gap_penalty ) std::cout << "   Checking results: " << (sinfo.verify(output_filename, "aligned-affine.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    if ( exec_mode == 16 || exec_mode < 1) {
+        AffineMatrix A;
+        A.resize(sinfo.rows, sinfo.cols); // allocated up front, like S
+        auto t_affine_tiled_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_affine_tiled(A, SUB, cmap, gap_open, gap_extend, tile_rows, tile_cols);
+
+        auto t_affine_tiled_2 = std::chrono::high_resolution_clock::now();
+
+        sinfo.traceback_affine_and_save("aligned-affine-tiled.txt", A, SUB, cmap, gap_open);
+
+        std::cout << "\n== Affine Gap Tiled version (" << tile_rows << "x" << tile_cols << " tiles, gap open " << gap_open << ", extend " << gap_extend << ") completed in " << std::chrono::duration<float>(t_affine_tiled_2 - t_affine_tiled_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_affine_tiled_2 - t_affine_tiled_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << sinfo.alignment_score << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify("aligned-affine.txt", "aligned-affine-tiled.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    if ( exec_mode == 17 || exec_mode < 1) {
+        AffineMatrix A;
+        A.resize(sinfo.rows, sinfo.cols); // allocated up front, like S
+        auto t_affine_simd_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_affine_simd(A, SUB, cmap, gap_open, gap_extend);
+
+        auto t_affine_simd_2 = std::chrono::high_resolution_clock::now();
+
+        sinfo.traceback_affine_and_save("aligned-affine-simd.txt", A, SUB, cmap, gap_open);
+
+        std::cout << "\n== Affine Gap SIMD version (gap open " << gap_open << ", extend " << gap_extend << ") completed in " << std::chrono::duration<float>(t_affine_simd_2 - t_affine_simd_1).count() << " seconds." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, std::chrono::duration<double>(t_affine_simd_2 - t_affine_simd_1).count()) << std::endl; 
+        std::cout << "   Entries visited: " << entries_visited << " " << (entries_visited == expected_visited ? "" : "NOT OK") << std::endl; 
+        std::cout << "   Score: " << sinfo.alignment_score << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (sinfo.verify("aligned-affine.txt", "aligned-affine-simd.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    // alignment engine: the pair twice through an engine leased from a pool, the second lease gets
+    // the same engine back with its workspace grown by the first run
+    if ( exec_mode == 18 || exec_mode < 1) {
+        EnginePool pool(SUB, sinfo.SUB_size, cmap);
+        std::vector<int> x, y;
+        AlignmentResult res;
+        size_t workspace_bytes = 0;
+        double first_run = 0, warm_run = 0;
+        for (int run = 0; run < 2; ++run) {
+            auto engine = pool.lease();
+            if (run == 0) {
+                try {
+                    x = engine->encode(sinfo.X);
+                    y = engine->encode(sinfo.Y);
+                } catch (const std::out_of_range& e) {
+                    std::cerr << "[error]: " << e.what() << "!" << std::endl;
+                    exit(-1);
+                }
+            }
+            auto t_engine_1 = std::chrono::high_resolution_clock::now();
+            res = engine->align(x, y);
+            auto t_engine_2 = std::chrono::high_resolution_clock::now();
+            (run == 0 ? first_run : warm_run) = std::chrono::duration<double>(t_engine_2 - t_engine_1).count();
+            workspace_bytes = engine->workspace_bytes();
+        }
+
+        sinfo.X_aligned.assign(res.X_aligned.begin(), res.X_aligned.end());
+        sinfo.Y_aligned.assign(res.Y_aligned.begin(), res.Y_aligned.end());
+        sinfo.save_alignment("aligned-engine.txt");
+
+        std::cout << "\n== Alignment engine completed in " << first_run << " seconds (workspace allocated), " << warm_run << " seconds (warm workspace), with traceback." << std::endl; 
+        std::cout << "   GCUPS: " << gcups(sinfo.rows, sinfo.cols, warm_run) << std::endl; 
+        std::cout << "   Workspace: " << workspace_bytes / (1 << 20) << " MB" << std::endl; 
+        std::cout << "   Score: " << res.score << ", Similarity Score: " << res.similarity_score << ", Identity Score: " << res.identity_score << ", Gaps: " << res.gap_count << ", Length (with gaps): " << res.X_aligned.size() << std::endl; 
+        if ( exec_mode < 1 ) std::cout << "   Checking results: " << (res.score == score_sequential && sinfo.verify(output_filename, "aligned-engine.txt") ? "OK" : "NOT OK") << std::endl;
+        sinfo.reset();
+    }
+
+    // incremental version: align X and Y, then revise them and recompute only what changed
+    bool revised = !revised_X_filename.empty() || !revised_Y_filename.empty();
+    if ( exec_mode == 13 || (exec_mode < 1 && revised)) {
+        std::vector<char> X_old = sinfo.X, Y_old = sinfo.Y;
+        std::vector<char> X_new = revised_X_filename.empty() ? X_old : sinfo.load_sequence(revised_X_filename);
+        std::vector<char> Y_new = revised_Y_filename.empty() ? Y_old : sinfo.load_sequence(revised_Y_filename);
+        int max_rows = std::max(X_old.size(), X_new.size()) + 1, max_cols = std::max(Y_old.size(), Y_new.size()) + 1;
+        float** R = allocate(max_rows, max_cols, 0); // room for both matrices
+
+        sinfo.gpsa_sequential(R, SUB, cmap);
+
+        int first_row, first_col;
+        sinfo.revise_sequences(X_new, Y_new, first_row, first_col);
+        auto t_inc_1 = std::chrono::high_resolution_clock::now();
+
+        entries_visited = sinfo.gpsa_incremental(R, SUB, cmap, first_row, first_col);
+
+        auto t_inc_2 = std::chrono::high_resolution_clock::now();
+
+        sinfo.reset();
+        sinfo.traceback_and_save("aligned-incremental.txt", R, SUB, cmap);
+        float score = R[sinfo.rows-1][sinfo.cols-1];
+        unsigned long revised_visited = (unsigned long)(sinfo.rows-1)*(sinfo.cols-1)+sinfo.rows+sinfo.cols-1;
+
+        std::cout << "\n== Incremental version (from row " << first_row << ", column " << first_col << " of [" << sinfo.rows << "x" << sinfo.cols << "]) completed in " << std::chrono::duration<float>(t_inc_2 - t_inc_1).count() << " seconds." << std::endl; 
+        std::cout << "   Entries recomputed: " << entries_visited << " of " << revised_visited << std::endl; 
+        std::cout << "   Score: " << score << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl; 
+
+        // a fresh run of the revised pair, for the time and as reference
+        sinfo.reset();
+        auto t_fresh_1 = std::chrono::high_resolution_clock::now();
+        sinfo.gpsa_sequential(R, SUB, cmap);
+        auto t_fresh_2 = std::chrono::high_resolution_clock::now();
+        sinfo.traceback_and_save("aligned-fresh.txt", R, SUB, cmap);
+        std::cout << "   Fresh run: " << std::chrono::duration<float>(t_fresh_2 - t_fresh_1).count() << " seconds, Score: " << R[sinfo.rows-1][sinfo.cols-1] << std::endl; 
+        std::cout << "   Checking results: " << (R[sinfo.rows-1][sinfo.cols-1] == score && sinfo.verify("aligned-fresh.txt", "aligned-incremental.txt") ? "OK" : "NOT OK") << std::endl;
+
+        // back to the original pair
+        sinfo.set_sequences(X_old, Y_old);
+        sinfo.reset();
+        deallocate(R);
     }
 
-    deallocate(S);
+    if (S && numa) deallocate_numa(S, sinfo.rows, sinfo.cols);
+    else if (S) deallocate(S);
     deallocate(SUB);
 
     return 0;
@@ -0,0 +1,176 @@
+#include <iostream>
+#include <chrono>
+#include <functional>
+#include <mpi.h>
+#include "helpers.hpp"
+#include "implementation.hpp"
+
+// Distributed version: the rows of S are split into one band per rank. Each rank keeps its band
+// plus a halo row (the last row of the rank above), so the matrix can span the memory of several
+// nodes. The fill pipelines over column chunks: a rank receives the halo segment of a chunk from
+// the rank above, fills its band for that chunk and sends its last row segment on, so rank r
+// starts r chunks after rank 0. The traceback runs backwards through the ranks: each rank traces
+// inside its band and passes the column where the path leaves it upwards, then sends its part of
+// the alignment to rank 0, which writes the output file.
+
+// Rows first_row .. first_row + n - 1 of S, band[0] being the halo row
+struct RowBand {
+    float** band;
+    int first_row;
+};
+
+inline float cell(const RowBand& S, int i, int j) { return S.band[i - S.first_row][j]; }
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+    int rank, n_ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+
+    bool print_runtime_only = false;
+    int exec_mode = 0; // 0. mpi version checked against the sequential one on rank 0, otherwise mpi version only
+    int grain_size = 1, tile_rows = 256, tile_cols = 256, band_width = 0;
+    float x_drop = 0, gap_open = -11, gap_extend = -1;
+    bool batch = false, numa = false, huge_pages = false;
+    int chunk_cols = 1024; // columns per pipeline step
+    std::string pairs_filename = "", revised_X_filename = "", revised_Y_filename = "";
+	std::string X_filename = "X.txt", Y_filename = "Y.txt", output_filename = "aligned-sequential.txt";
+	std::string substitution_matrix_file = "blosum62.txt";
+	parse_args(argc, argv, X_filename, Y_filename, output_filename, grain_size, exec_mode, print_runtime_only, tile_rows, tile_cols, band_width, x_drop, batch, pairs_filename, numa, huge_pages, revised_X_filename, revised_Y_filename, gap_open, gap_extend);
+    for (int i = 1; i < argc - 1; ++i)
+        if (std::string(argv[i]).compare("--chunk-cols") == 0)
+            chunk_cols = std::stoi(argv[i + 1]);
+
+    // every rank reads the (small) inputs
+    SequenceInfo sinfo(X_filename, Y_filename);
+    std::unordered_map<char, int> cmap;
+    float** SUB = sinfo.substitution_matrix_from_file(substitution_matrix_file, cmap);
+    sinfo.gap_penalty = SUB[0][cmap['*']];
+    sinfo.encode_sequences(cmap);
+    float gap_penalty = sinfo.gap_penalty;
+    int rows = sinfo.rows, cols = sinfo.cols;
+
+    if (rows - 1 < n_ranks) {
+        if (rank == 0) std::cerr << "[error]: " << n_ranks << " ranks for " << rows - 1 << " rows!" << std::endl;
+        MPI_Finalize();
+        return -1;
+    }
+
+    // rows 1 .. rows-1 in bands [r0, r1), the first bands one row longer when it does not divide
+    int n_inner = rows - 1, base = n_inner / n_ranks, extra = n_inner % n_ranks;
+    int r0 = 1 + rank * base + std::min(rank, extra);
+    int r1 = r0 + base + (rank < extra ? 1 : 0);
+    int band_rows = r1 - r0 + 1; // with the halo row r0 - 1
+
+    if (rank == 0) {
+        std::cout << "Loaded X and Y sequences with sizes " << rows - 1 << " and " << cols - 1 << std::endl;
+        std::cout << "Matrix S size: [" << rows << "x" << cols << "], " << n_ranks << " ranks, about " << band_rows << " rows each, " << chunk_cols << " columns per step" << std::endl;
+    }
+
+    float** band = allocate(band_rows, cols, 0);
+    RowBand S_band{band, r0 - 1};
+    const int *x = sinfo.X_codes.data() + (r0 - 1), *y = sinfo.Y_codes.data();
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto t_mpi_1 = std::chrono::high_resolution_clock::now();
+
+    // Boundary: column 0 of the band, and row 0 on rank 0
+    for (int i = 0; i < band_rows; i++)
+        band[i][0] = (r0 - 1 + i) * gap_penalty;
+    if (rank == 0)
+        for (int j = 0; j < cols; j++)
+            band[0][j] = j * gap_penalty;
+
+    // One tag for all chunks: MPI keeps messages between two ranks with the same tag in order, and
+    // a tag per chunk (the column) could pass MPI_TAG_UB, which is only guaranteed to be 32767
+    const int halo_tag = 4;
+    std::vector<MPI_Request> sends;
+    for (int c0 = 1; c0 < cols; c0 += chunk_cols) {
+        int c1 = std::min(cols, c0 + chunk_cols);
+        if (rank > 0)
+            MPI_Recv(&band[0][c0], c1 - c0, MPI_FLOAT, rank - 1, halo_tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+        // band-local rows 1 .. band_rows-1, x is offset so that row i reads X_codes[r0 - 1 + i - 1]
+        fill_tile(band, SUB[0], sinfo.SUB_size, x, y, gap_penalty, 1, band_rows, c0, c1);
+
+        // the last row is not written again, so it can be sent without a copy
+        if (rank < n_ranks - 1) {
+            sends.emplace_back();
+            MPI_Isend(&band[band_rows - 1][c0], c1 - c0, MPI_FLOAT, rank + 1, halo_tag, MPI_COMM_WORLD, &sends.back());
+        }
+    }
+    MPI_Waitall(sends.size(), sends.data(), MPI_STATUSES_IGNORE);
+
+    auto t_mpi_2 = std::chrono::high_resolution_clock::now();
+
+    // Traceback, last rank first. The path enters the band at row r1 - 1 in column j.
+    int j = cols - 1;
+    if (rank < n_ranks - 1)
+        MPI_Recv(&j, 1, MPI_INT, rank + 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    j = sinfo.traceback_segment(S_band, SUB, cmap, r1 - 1, j, rank == 0 ? -1 : r0 - 1);
+    if (rank > 0)
+        MPI_Send(&j, 1, MPI_INT, rank - 1, 0, MPI_COMM_WORLD);
+
+    float score = 0;
+    if (rank == n_ranks - 1) score = band[band_rows - 1][cols - 1];
+    MPI_Bcast(&score, 1, MPI_FLOAT, n_ranks - 1, MPI_COMM_WORLD);
+
+    // Gather the pieces on rank 0, each built backwards like the whole alignment
+    int stats[3] = {sinfo.similarity_score, sinfo.identity_score, sinfo.gap_count}, totals[3];
+    MPI_Reduce(stats, totals, 3, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    int length = sinfo.X_aligned.size();
+    if (rank > 0) {
+        MPI_Send(&length, 1, MPI_INT, 0, 1, MPI_COMM_WORLD);
+        MPI_Send(sinfo.X_aligned.data(), length, MPI_CHAR, 0, 2, MPI_COMM_WORLD);
+        MPI_Send(sinfo.Y_aligned.data(), length, MPI_CHAR, 0, 3, MPI_COMM_WORLD);
+    } else {
+        std::vector<char> X_aligned, Y_aligned;
+        for (int r = n_ranks - 1; r > 0; --r) {
+            int n;
+            MPI_Recv(&n, 1, MPI_INT, r, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            size_t at = X_aligned.size();
+            X_aligned.resize(at + n);
+            Y_aligned.resize(at + n);
+            MPI_Recv(&X_aligned[at], n, MPI_CHAR, r, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Recv(&Y_aligned[at], n, MPI_CHAR, r, 3, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+        X_aligned.insert(X_aligned.end(), sinfo.X_aligned.begin(), sinfo.X_aligned.end());
+        Y_aligned.insert(Y_aligned.end(), sinfo.Y_aligned.begin(), sinfo.Y_aligned.end());
+        std::reverse(X_aligned.begin(), X_aligned.end());
+        std::reverse(Y_aligned.begin(), Y_aligned.end());
+        sinfo.X_aligned = X_aligned;
+        sinfo.Y_aligned = Y_aligned;
+        sinfo.similarity_score = totals[0];
+        sinfo.identity_score = totals[1];
+        sinfo.gap_count = totals[2];
+    }
+
+    auto t_mpi_3 = std::chrono::high_resolution_clock::now();
+
+    if (rank == 0) {
+        sinfo.save_alignment("aligned-mpi.txt");
+
+        std::cout << "\n== MPI version (" << n_ranks << " ranks) completed in " << std::chrono::duration<float>(t_mpi_2 - t_mpi_1).count() << " seconds, traceback and gather " << std::chrono::duration<float>(t_mpi_3 - t_mpi_2).count() << " seconds." << std::endl;
+        std::cout << "   GCUPS: " << gcups(rows, cols, std::chrono::duration<double>(t_mpi_2 - t_mpi_1).count()) << std::endl;
+        std::cout << "   Score: " << score << ", Similarity Score: " << sinfo.similarity_score << ", Identity Score: " << sinfo.identity_score << ", Gaps: " << sinfo.gap_count << ", Length (with gaps): " << sinfo.X_aligned.size() << std::endl;
+    }
+    deallocate(band);
+
+    // check against the sequential version on rank 0 (needs the full matrix there)
+    if (rank == 0 && exec_mode < 1) {
+        SequenceInfo ref(X_filename, Y_filename);
+        float** S = allocate(rows, cols, 0);
+        ref.gpsa_sequential(S, SUB, cmap);
+        ref.traceback_and_save(output_filename, S, SUB, cmap);
+
+        std::cout << "   Checking results: " << (S[rows-1][cols-1] == score && sinfo.verify(output_filename, "aligned-mpi.txt") ? "OK" : "NOT OK") << std::endl;
+        deallocate(S);
+    }
+
+    deallocate(SUB);
+    MPI_Finalize();
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <omp.h>
+
+#ifndef NUMA
+#define NUMA
+
+// NUMA placement without libnuma: the topology comes from /sys/devices/system/node, threads are
+// pinned with sched affinity and pages land on the node of the thread that first touches them.
+
+// CPUs of a "0-3,8-11" list
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        auto dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int c = first; c <= last; ++c)
+            cpus.push_back(c);
+    }
+    return cpus;
+}
+
+// Where every thread runs. Threads fill the allowed CPUs of node 0 first, then node 1, ...,
+// so consecutive thread ids share a node.
+struct NumaLayout {
+    int n_nodes = 1;
+    std::vector<int> cpu_of_thread, node_of_thread;
+
+    static NumaLayout detect(int n_threads) {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+
+        // allowed CPUs grouped by node, one node with every allowed CPU when sysfs has no nodes
+        std::vector<std::vector<int>> node_cpus;
+        std::error_code ec;
+        for (int node = 0; std::filesystem::exists("/sys/devices/system/node/node" + std::to_string(node), ec); ++node) {
+            std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string list;
+            std::getline(ifs, list);
+            std::vector<int> cpus;
+            for (int c: parse_cpu_list(list))
+                if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed))
+                    cpus.push_back(c);
+            if (!cpus.empty())
+                node_cpus.push_back(cpus);
+        }
+        if (node_cpus.empty()) {
+            node_cpus.emplace_back();
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &allowed))
+                    node_cpus[0].push_back(c);
+        }
+
+        NumaLayout layout;
+        layout.n_nodes = node_cpus.size();
+        std::vector<std::pair<int, int>> slots; // (cpu, node)
+        for (int node = 0; node < (int)node_cpus.size(); ++node)
+            for (int c: node_cpus[node])
+                slots.push_back({c, node});
+
+        // more threads than CPUs wrap around
+        for (int t = 0; t < n_threads; ++t) {
+            layout.cpu_of_thread.push_back(slots[t % slots.size()].first);
+            layout.node_of_thread.push_back(slots[t % slots.size()].second);
+        }
+        return layout;
+    }
+};
+
+void pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Pins OpenMP thread t to layout.cpu_of_thread[t]. libgomp keeps its thread pool, so later
+// parallel regions with the same thread count run on the same CPUs.
+void pin_omp_threads(const NumaLayout& layout) {
+#pragma omp parallel
+    pin_current_thread(layout.cpu_of_thread[omp_get_thread_num() % layout.cpu_of_thread.size()]);
+}
+
+const size_t huge_page_size = 2 << 20;
+
+// Contiguous matrix like allocate(), on 2 MB pages. With huge_pages set it asks for explicit
+// huge pages (MAP_HUGETLB, needs pages reserved in /proc/sys/vm/nr_hugepages) and clears the flag
+// when there are none; otherwise, or then, it uses transparent huge pages (madvise).
+// The rows are first touched in blocks of block_rows, block b by OpenMP thread b % n_threads,
+// so with pinned threads every block sits on the node of thread b % n_threads, the owner of tile
+// row b in run_tile_grid.
+float** allocate_numa(unsigned int height, unsigned int width, const float& val, int block_rows, bool& huge_pages) {
+    size_t bytes = ((size_t)height * width * sizeof(float) + huge_page_size - 1) / huge_page_size * huge_page_size;
+    void* mem = MAP_FAILED;
+
+    if (huge_pages)
+        mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mem == MAP_FAILED) {
+        huge_pages = false;
+
+        // over-map by one huge page and trim, so the start is 2 MB aligned for THP
+        char* raw = (char*)mmap(nullptr, bytes + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            std::cerr << "[error]: could not map " << bytes << " bytes for the matrix!" << std::endl;
+            exit(-1);
+        }
+        size_t head = (huge_page_size - (uintptr_t)raw % huge_page_size) % huge_page_size;
+        if (head) munmap(raw, head);
+        munmap(raw + head + bytes, huge_page_size - head);
+        mem = raw + head;
+        madvise(mem, bytes, MADV_HUGEPAGE);
+    }
+
+    float** ptr = new float*[height];
+    float* data = (float*)mem;
+    for (unsigned int i = 0; i < height; ++i)
+        ptr[i] = data + (size_t)i * width;
+
+    int n_blocks = (height + block_rows - 1) / block_rows;
+#pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < n_blocks; ++b) {
+        unsigned int end = std::min(height, (unsigned int)(b + 1) * block_rows);
+        for (unsigned int i = b * block_rows; i < end; ++i)
+            std::fill(ptr[i], ptr[i] + width, val);
+    }
+
+    return ptr;
+}
+
+void deallocate_numa(float** data, unsigned int height, unsigned int width) {
+    size_t bytes = ((size_t)height * width * sizeof(float) + huge_page_size - 1) / huge_page_size * huge_page_size;
+    munmap(data[0], bytes);
+    delete [] data;
+}
+#endif
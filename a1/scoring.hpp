@@ -0,0 +1,79 @@
+#include <unordered_map>
+
+#ifndef SCORING
+#define SCORING
+
+// Scoring schemes fixed at compile time. A kernel templated on one of them sees the substitution
+// scores and the gap penalty as constants (a table in read-only data, or a compare and select for
+// DNA), instead of loads through SUB. scheme_matches tells whether a loaded matrix and cmap are
+// exactly a given scheme, so callers can dispatch at runtime and fall back to RuntimeScoring.
+
+// BLOSUM62 in the order of blosum62.txt
+struct Blosum62Scoring {
+    static constexpr int size = 24;
+    static constexpr const char* letters = "ARNDCQEGHILKMFPSTWYVBZX*";
+    static constexpr float gap = -4;
+    static constexpr float table[size][size] = {
+        { 4, -1, -2, -2,  0, -1, -1,  0, -2, -1, -1, -1, -1, -2, -1,  1,  0, -3, -2,  0, -2, -1,  0, -4}, // A
+        {-1,  5,  0, -2, -3,  1,  0, -2,  0, -3, -2,  2, -1, -3, -2, -1, -1, -3, -2, -3, -1,  0, -1, -4}, // R
+        {-2,  0,  6,  1, -3,  0,  0,  0,  1, -3, -3,  0, -2, -3, -2,  1,  0, -4, -2, -3,  3,  0, -1, -4}, // N
+        {-2, -2,  1,  6, -3,  0,  2, -1, -1, -3, -4, -1, -3, -3, -1,  0, -1, -4, -3, -3,  4,  1, -1, -4}, // D
+        { 0, -3, -3, -3,  9, -3, -4, -3, -3, -1, -1, -3, -1, -2, -3, -1, -1, -2, -2, -1, -3, -3, -2, -4}, // C
+        {-1,  1,  0,  0, -3,  5,  2, -2,  0, -3, -2,  1,  0, -3, -1,  0, -1, -2, -1, -2,  0,  3, -1, -4}, // Q
+        {-1,  0,  0,  2, -4,  2,  5, -2,  0, -3, -3,  1, -2, -3, -1,  0, -1, -3, -2, -2,  1,  4, -1, -4}, // E
+        { 0, -2,  0, -1, -3, -2, -2,  6, -2, -4, -4, -2, -3, -3, -2,  0, -2, -2, -3, -3, -1, -2, -1, -4}, // G
+        {-2,  0,  1, -1, -3,  0,  0, -2,  8, -3, -3, -1, -2, -1, -2, -1, -2, -2,  2, -3,  0,  0, -1, -4}, // H
+        {-1, -3, -3, -3, -1, -3, -3, -4, -3,  4,  2, -3,  1,  0, -3, -2, -1, -3, -1,  3, -3, -3, -1, -4}, // I
+        {-1, -2, -3, -4, -1, -2, -3, -4, -3,  2,  4, -2,  2,  0, -3, -2, -1, -2, -1,  1, -4, -3, -1, -4}, // L
+        {-1,  2,  0, -1, -3,  1,  1, -2, -1, -3, -2,  5, -1, -3, -1,  0, -1, -3, -2, -2,  0,  1, -1, -4}, // K
+        {-1, -1, -2, -3, -1,  0, -2, -3, -2,  1,  2, -1,  5,  0, -2, -1, -1, -1, -1,  1, -3, -1, -1, -4}, // M
+        {-2, -3, -3, -3, -2, -3, -3, -3, -1,  0,  0, -3,  0,  6, -4, -2, -2,  1,  3, -1, -3, -3, -1, -4}, // F
+        {-1, -2, -2, -1, -3, -1, -1, -2, -2, -3, -3, -1, -2, -4,  7, -1, -1, -4, -3, -2, -2, -1, -2, -4}, // P
+        { 1, -1,  1,  0, -1,  0,  0,  0, -1, -2, -2,  0, -1, -2, -1,  4,  1, -3, -2, -2,  0,  0,  0, -4}, // S
+        { 0, -1,  0, -1, -1, -1, -1, -2, -2, -1, -1, -1, -1, -2, -1,  1,  5, -2, -2,  0, -1, -1,  0, -4}, // T
+        {-3, -3, -4, -4, -2, -2, -3, -2, -2, -3, -2, -3, -1,  1, -4, -3, -2, 11,  2, -3, -4, -3, -2, -4}, // W
+        {-2, -2, -2, -3, -2, -1, -2, -3,  2, -1, -1, -2, -1,  3, -3, -2, -2,  2,  7, -1, -3, -2, -1, -4}, // Y
+        { 0, -3, -3, -3, -1, -2, -2, -3, -3,  3,  1, -2,  1, -1, -2, -2,  0, -3, -1,  4, -3, -2, -1, -4}, // V
+        {-2, -1,  3,  4, -3,  0,  1, -1,  0, -3, -4,  0, -3, -3, -2,  0, -1, -4, -3, -3,  4,  1, -1, -4}, // B
+        {-1,  0,  0,  1, -3,  3,  4, -2,  0, -3, -3,  1, -1, -3, -1,  0, -1, -3, -2, -2,  1,  4, -1, -4}, // Z
+        { 0, -1, -1, -1, -2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -2,  0,  0, -2, -1, -1, -1, -1, -1, -4}, // X
+        {-4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4,  1}, // *
+    };
+
+    static float score(int a, int b) { return table[a][b]; }
+};
+
+// Match / mismatch over ACGT, as built by substitution_matrix_from_scheme (the '*' row and
+// column hold the gap penalty)
+template <int Match, int Mismatch, int Gap>
+struct DnaScoring {
+    static constexpr int size = 5;
+    static constexpr const char* letters = "ACGT*";
+    static constexpr float gap = Gap;
+
+    static float score(int a, int b) { return (a | b) >= 4 ? Gap : a == b ? Match : Mismatch; }
+};
+
+// The scheme loaded at runtime, same interface
+struct RuntimeScoring {
+    const float* sub;
+    int size;
+    float gap;
+
+    float score(int a, int b) const { return sub[a * size + b]; }
+};
+
+// True when SUB and cmap are exactly Scheme: same letters at the same indices, same scores
+template <typename Scheme>
+bool scheme_matches(float** SUB, int SUB_size, std::unordered_map<char, int>& cmap) {
+    if (SUB_size != Scheme::size || (int)cmap.size() != Scheme::size) return false;
+    for (int k = 0; k < Scheme::size; ++k) {
+        auto it = cmap.find(Scheme::letters[k]);
+        if (it == cmap.end() || it->second != k) return false;
+    }
+    for (int a = 0; a < Scheme::size; ++a)
+        for (int b = 0; b < Scheme::size; ++b)
+            if (SUB[a][b] != Scheme::score(a, b)) return false;
+    return SUB[0][cmap['*']] == Scheme::gap;
+}
+#endif
@@ -0,0 +1,367 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <sstream>
+#include <charconv>
+#include <filesystem>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <poll.h>
+#include "helpers.hpp"
+#include "engine.hpp"
+
+// Long-lived alignment server. The substitution matrices are loaded once, every worker thread keeps
+// one AlignmentEngine per matrix, so its workspace stays warm between requests. Requests come over a
+// Unix domain socket (--socket <path>) or stdin, one per line, and any number of them may be sent
+// without waiting for the answers:
+//   align <id> <X> <Y> [<matrix>]   score, statistics and the aligned sequences
+//   score <id> <X> <Y> [<matrix>]   score only, in linear space
+//   stats                           counters of the server
+// The answers are streamed back as they complete, so not in request order, tagged with the id:
+//   <id> ok <score> <similarity> <identity> <gaps> <length> [<X aligned> <Y aligned>]
+//   <id> error <message>
+// Requests are queued by size: pairs of at least --large-cells cells go to a queue that only the
+// first --large-workers workers serve (first), so large pairs do not hold up the small ones.
+
+using Clock = std::chrono::steady_clock;
+
+struct Matrix {
+    std::string name;
+    float** SUB;
+    int size;
+    std::unordered_map<char, int> cmap;
+};
+
+// One client: a socket, or stdin/stdout. The last job holding it closes the socket, so a client
+// that shuts down its sending side reads until every answer is in.
+class Connection {
+public:
+    Connection(int in_fd, int out_fd, bool owned) : in_fd(in_fd), out_fd(out_fd), owned(owned) {}
+    ~Connection() { if (owned) close(in_fd); }
+
+    bool read_line(std::string& line) {
+        line.clear();
+        while (true) {
+            auto nl = std::find(buffer.begin() + start, buffer.begin() + end, '\n');
+            if (nl != buffer.begin() + end) {
+                line.append(buffer.begin() + start, nl);
+                start = nl - buffer.begin() + 1;
+                return true;
+            }
+            line.append(buffer.begin() + start, buffer.begin() + end);
+            start = end = 0;
+            ssize_t n = read(in_fd, buffer.data(), buffer.size());
+            if (n <= 0) return !line.empty();
+            end = n;
+        }
+    }
+
+    // whole lines from several workers, so under a lock
+    void send(const std::string& line) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t done = 0;
+        while (!broken && done < line.size()) {
+            ssize_t n = write(out_fd, line.data() + done, line.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) broken = true;
+            else done += n;
+        }
+    }
+
+    // unblocks a read_line() waiting for the client at shutdown, the queued answers still go out
+    void interrupt() { shutdown(in_fd, SHUT_RD); }
+
+private:
+    int in_fd, out_fd;
+    bool owned, broken = false;
+    std::mutex mutex;
+    std::array<char, 1 << 16> buffer;
+    size_t start = 0, end = 0;
+};
+
+struct Job {
+    std::shared_ptr<Connection> conn;
+    std::string id, X, Y;
+    int matrix = 0;
+    bool traceback = true;
+    Clock::time_point arrival;
+
+    unsigned long cells() const { return (unsigned long)(X.size() + 1) * (Y.size() + 1); }
+};
+
+// Two FIFO queues by size. Workers of the large lane take large jobs first and small ones when
+// there are none, the others only take small jobs.
+class Scheduler {
+public:
+    Scheduler(unsigned long large_cells) : large_cells(large_cells) {}
+
+    void push(Job&& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            (job.cells() >= large_cells ? large : small).push_back(std::move(job));
+        }
+        ready.notify_all();
+    }
+
+    // false once closed and the queues of this lane are empty
+    bool pop(Job& job, bool large_lane) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [&] { return closed || !small.empty() || (large_lane && !large.empty()); });
+        std::deque<Job>* queue = large_lane && !large.empty() ? &large : !small.empty() ? &small : nullptr;
+        if (!queue) return false;
+        job = std::move(queue->front());
+        queue->pop_front();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        ready.notify_all();
+    }
+
+    std::pair<size_t, size_t> queued() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return {small.size(), large.size()};
+    }
+
+private:
+    unsigned long large_cells;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Job> small, large;
+    bool closed = false;
+};
+
+struct Stats {
+    std::atomic<unsigned long> served{0}, errors{0}, cells{0};
+    std::atomic<unsigned long> wait_us{0}, service_us{0}; // queue wait and align() time
+
+    std::string summary(Scheduler& sched) {
+        auto [small, large] = sched.queued();
+        unsigned long n = std::max(1ul, served.load());
+        std::stringstream ss;
+        ss << "stats served " << served << " errors " << errors << " cells " << cells
+           << " mean_wait_ms " << wait_us / 1e3 / n << " mean_service_ms " << service_us / 1e3 / n
+           << " queued_small " << small << " queued_large " << large << "\n";
+        return ss.str();
+    }
+};
+
+void worker(Scheduler& sched, const std::vector<Matrix>& matrices, bool large_lane, int warm_length, Stats& stats) {
+    std::vector<std::unique_ptr<AlignmentEngine>> engines;
+    for (auto& m: matrices)
+        engines.push_back(std::make_unique<AlignmentEngine>(m.SUB, m.size, m.cmap));
+
+    // grow the workspaces up front, so the first requests do not allocate
+    if (warm_length > 0) {
+        std::vector<int> warm(warm_length, 0);
+        for (auto& engine: engines)
+            engine->align(warm, warm);
+    }
+
+    std::vector<int> x, y;
+    std::string out;
+    Job job;
+    while (sched.pop(job, large_lane)) {
+        AlignmentEngine& engine = *engines[job.matrix];
+        if (!engine.encode(job.X, x) || !engine.encode(job.Y, y)) {
+            stats.errors++;
+            job.conn->send(job.id + " error residue not in matrix " + matrices[job.matrix].name + "\n");
+            job = Job();
+            continue;
+        }
+
+        auto t_start = Clock::now();
+        AlignmentResult r = engine.align(x, y, job.traceback);
+        auto t_end = Clock::now();
+
+        out.clear();
+        out.append(job.id).append(" ok ");
+        char score[32];
+        out.append(score, std::to_chars(score, score + sizeof(score), r.score).ptr).append(" ");
+        out.append(std::to_string(r.similarity_score)).append(" ");
+        out.append(std::to_string(r.identity_score)).append(" ");
+        out.append(std::to_string(r.gap_count)).append(" ");
+        out.append(std::to_string(r.X_aligned.size()));
+        if (job.traceback)
+            out.append(" ").append(r.X_aligned).append(" ").append(r.Y_aligned);
+        out.append("\n");
+        job.conn->send(out);
+
+        stats.served++;
+        stats.cells += r.cells;
+        stats.wait_us += std::chrono::duration_cast<std::chrono::microseconds>(t_start - job.arrival).count();
+        stats.service_us += std::chrono::duration_cast<std::chrono::microseconds>(t_end - t_start).count();
+        job = Job(); // drops the connection
+    }
+}
+
+// Reads the requests of one client into the scheduler until it closes its side
+void serve(std::shared_ptr<Connection> conn, Scheduler& sched, const std::vector<Matrix>& matrices, unsigned long max_cells, Stats& stats) {
+    std::string line;
+    while (conn->read_line(line)) {
+        std::stringstream ss(line);
+        std::string command, matrix;
+        Job job;
+        ss >> command;
+        if (command.empty()) continue;
+        if (command == "stats") {
+            conn->send(stats.summary(sched));
+            continue;
+        }
+
+        ss >> job.id >> job.X >> job.Y >> matrix;
+        if (job.id.empty()) job.id = "?";
+        std::string error;
+        if (command != "align" && command != "score") error = "unknown command " + command;
+        else if (job.Y.empty()) error = "expected " + command + " <id> <X> <Y> [<matrix>]";
+        else if (job.cells() > max_cells) error = "pair larger than " + std::to_string(max_cells) + " cells";
+        else if (!matrix.empty()) {
+            auto m = std::find_if(matrices.begin(), matrices.end(), [&](const Matrix& m) { return m.name == matrix; });
+            if (m == matrices.end()) error = "unknown matrix " + matrix;
+            else job.matrix = m - matrices.begin();
+        }
+        if (!error.empty()) {
+            stats.errors++;
+            conn->send(job.id + " error " + error + "\n");
+            continue;
+        }
+
+        job.traceback = command == "align";
+        job.conn = conn;
+        job.arrival = Clock::now();
+        sched.push(std::move(job));
+    }
+}
+
+std::atomic<bool> stopping{false};
+
+int main(int argc, char **argv)
+{
+    std::string socket_path = ""; // stdin and stdout without
+    std::vector<std::string> sub_files;
+    int n_workers = std::max(1u, std::thread::hardware_concurrency()), n_large_workers = 0;
+    unsigned long large_cells = 1ul << 22, max_cells = 1ul << 28;
+    int warm_length = 0;
+    std::string usage("Usage: --socket <path> --sub <matrix-filename|dna> (repeatable) --workers <n> --large-workers <n> --large-cells <n> --max-cells <n> --warm <length>");
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (i + 1 >= argc) arg = "--help";
+        if (arg == "--socket") socket_path = argv[++i];
+        else if (arg == "--sub") sub_files.push_back(argv[++i]);
+        else if (arg == "--workers") n_workers = std::stoi(argv[++i]);
+        else if (arg == "--large-workers") n_large_workers = std::stoi(argv[++i]);
+        else if (arg == "--large-cells") large_cells = std::stoul(argv[++i]);
+        else if (arg == "--max-cells") max_cells = std::stoul(argv[++i]);
+        else if (arg == "--warm") warm_length = std::stoi(argv[++i]);
+        else {
+            std::cerr << usage << std::endl;
+            exit(-1);
+        }
+    }
+    if (sub_files.empty()) sub_files.push_back("blosum62.txt");
+    if (n_large_workers <= 0) n_large_workers = std::max(1, n_workers / 4);
+    n_large_workers = std::min(n_large_workers, n_workers);
+
+    // matrices, named by file stem (the first one is the default)
+    std::vector<Matrix> matrices;
+    for (auto& file: sub_files) {
+        SequenceInfo sinfo;
+        Matrix m;
+        if (file == "dna") {
+            m.name = "dna";
+            m.SUB = sinfo.substitution_matrix_from_scheme(1, -1, -2, "ACGT", m.cmap);
+        } else {
+            m.name = std::filesystem::path(file).stem();
+            m.SUB = sinfo.substitution_matrix_from_file(file, m.cmap);
+        }
+        m.size = sinfo.SUB_size;
+        matrices.push_back(m);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    Scheduler sched(large_cells);
+    Stats stats;
+    std::vector<std::thread> workers;
+    for (int w = 0; w < n_workers; ++w)
+        workers.emplace_back(worker, std::ref(sched), std::cref(matrices), w < n_large_workers, warm_length, std::ref(stats));
+
+    std::cerr << "gpsa-server: " << n_workers << " workers (" << n_large_workers << " for pairs of " << large_cells << "+ cells), matrices:";
+    for (auto& m: matrices) std::cerr << " " << m.name;
+    std::cerr << ", listening on " << (socket_path.empty() ? "stdin" : socket_path) << std::endl;
+
+    if (socket_path.empty()) {
+        serve(std::make_shared<Connection>(0, 1, false), sched, matrices, max_cells, stats);
+    } else {
+        signal(SIGINT, [](int) { stopping = true; });
+        signal(SIGTERM, [](int) { stopping = true; });
+
+        int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(socket_path.c_str());
+        if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 64) < 0) {
+            std::cerr << "[error]: cannot listen on " << socket_path << ": " << strerror(errno) << std::endl;
+            exit(-1);
+        }
+
+        // one reader thread per client, joined once it is done
+        struct Client {
+            std::thread reader;
+            std::weak_ptr<Connection> conn;
+            std::shared_ptr<std::atomic<bool>> done;
+        };
+        std::vector<Client> clients;
+
+        while (!stopping) {
+            pollfd pfd{listen_fd, POLLIN, 0};
+            if (poll(&pfd, 1, 200) > 0) {
+                int fd = accept(listen_fd, nullptr, nullptr);
+                if (fd >= 0) {
+                    auto conn = std::make_shared<Connection>(fd, fd, true);
+                    auto done = std::make_shared<std::atomic<bool>>(false);
+                    std::thread reader([conn, done, &sched, &matrices, max_cells, &stats]() mutable {
+                        serve(std::move(conn), sched, matrices, max_cells, stats);
+                        *done = true;
+                    });
+                    clients.push_back({std::move(reader), conn, done});
+                }
+            }
+            std::erase_if(clients, [](Client& c) {
+                if (!*c.done) return false;
+                c.reader.join();
+                return true;
+            });
+        }
+
+        for (auto& c: clients) {
+            if (auto conn = c.conn.lock()) conn->interrupt();
+            c.reader.join();
+        }
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+
+    // answer what is queued, then stop
+    sched.close();
+    for (auto& w: workers)
+        w.join();
+    std::cerr << "gpsa-server: " << stats.summary(sched);
+
+    for (auto& m: matrices)
+        deallocate(m.SUB);
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Per-tile tracing of the tiled versions, compiled in with -DGPSA_TRACE.
+// Each thread records the start and end of the tiles it runs into its own ring buffer (no
+// locking, the oldest events are overwritten when it is full). GPSA_TRACE_BEGIN and GPSA_TRACE_END
+// bracket the fill, GPSA_TRACE_REPORT then writes the events as Chrome trace JSON (open in
+// chrome://tracing or ui.perfetto.dev) and prints the idle share of every thread and the tiles
+// active per wavefront (ti + tj).
+// Without GPSA_TRACE the macros expand to nothing and their arguments are not evaluated.
+
+#ifndef TRACE
+#define TRACE
+
+#ifdef GPSA_TRACE
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <omp.h>
+
+struct TileEvent {
+    double start, end; // seconds since GPSA_TRACE_BEGIN
+    int ti, tj;
+};
+
+// One per thread, on its own cache lines
+struct alignas(64) TraceRing {
+    std::vector<TileEvent> events;
+    unsigned long count = 0; // events recorded, the next one goes to count % capacity
+};
+
+class TileTracer {
+public:
+    static constexpr unsigned long ring_capacity = 1 << 16;
+
+    void begin(int n_threads) {
+        rings.assign(n_threads, TraceRing());
+        for (auto& r: rings)
+            r.events.resize(ring_capacity);
+        t_begin = std::chrono::steady_clock::now();
+    }
+
+    double now() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t_begin).count();
+    }
+
+    void record(int thread, int ti, int tj, double start, double end) {
+        if (thread < 0 || thread >= (int)rings.size()) return;
+        TraceRing& r = rings[thread];
+        r.events[r.count++ % ring_capacity] = {start, end, ti, tj};
+    }
+
+    void end() {
+        t_end = now();
+    }
+
+    void report(const std::string& filename) const {
+        write_chrome_trace(filename);
+        print_summary();
+    }
+
+private:
+    std::vector<TraceRing> rings;
+    std::chrono::steady_clock::time_point t_begin;
+    double t_end = 0;
+
+    template <typename F>
+    void for_each_event(F f) const {
+        for (int t = 0; t < (int)rings.size(); ++t) {
+            unsigned long n = std::min(rings[t].count, ring_capacity);
+            for (unsigned long k = 0; k < n; ++k)
+                f(t, rings[t].events[k]);
+        }
+    }
+
+    void write_chrome_trace(const std::string& filename) const {
+        std::ofstream out(filename, std::ofstream::trunc);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        bool first = true;
+        for_each_event([&](int t, const TileEvent& e) {
+            out << (first ? "\n" : ",\n")
+                << "{\"name\": \"tile " << e.ti << "," << e.tj << "\", \"cat\": \"tile\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << t
+                << ", \"ts\": " << e.start * 1e6 << ", \"dur\": " << (e.end - e.start) * 1e6
+                << ", \"args\": {\"ti\": " << e.ti << ", \"tj\": " << e.tj << ", \"wavefront\": " << e.ti + e.tj << "}}";
+            first = false;
+        });
+        out << "\n]}" << std::endl;
+        std::cout << "   Trace: " << filename << std::endl;
+    }
+
+    void print_summary() const {
+        // idle share per thread over the whole traced region
+        for (int t = 0; t < (int)rings.size(); ++t) {
+            double busy = 0;
+            unsigned long n = std::min(rings[t].count, ring_capacity);
+            for (unsigned long k = 0; k < n; ++k)
+                busy += rings[t].events[k].end - rings[t].events[k].start;
+            std::cout << "   Thread " << t << ": " << rings[t].count << " tiles, idle " << (t_end > 0 ? 100 * (1 - busy / t_end) : 0) << "%"
+                      << (rings[t].count > ring_capacity ? " (ring buffer wrapped, oldest tiles dropped)" : "") << std::endl;
+        }
+
+        // per wavefront: the time from its first start to its last end, and how many of its
+        // tiles ran at once, on average (busy time / span) and at the peak
+        std::vector<std::vector<TileEvent>> waves;
+        for_each_event([&](int, const TileEvent& e) {
+            if ((int)waves.size() <= e.ti + e.tj) waves.resize(e.ti + e.tj + 1);
+            waves[e.ti + e.tj].push_back(e);
+        });
+
+        std::cout << "   Wavefront: tiles, span (ms), mean active, peak active" << std::endl;
+        for (int w = 0; w < (int)waves.size(); ++w) {
+            if (waves[w].empty()) continue;
+            double first = waves[w][0].start, last = waves[w][0].end, busy = 0;
+            std::vector<std::pair<double, int>> edges;
+            for (auto& e: waves[w]) {
+                first = std::min(first, e.start);
+                last = std::max(last, e.end);
+                busy += e.end - e.start;
+                edges.push_back({e.start, 1});
+                edges.push_back({e.end, -1});
+            }
+            std::sort(edges.begin(), edges.end());
+            int active = 0, peak = 0;
+            for (auto& e: edges)
+                peak = std::max(peak, active += e.second);
+
+            double span = last - first;
+            std::cout << "   " << w << ": " << waves[w].size() << ", " << span * 1e3 << ", " << (span > 0 ? busy / span : 1) << ", " << peak << std::endl;
+        }
+    }
+};
+
+inline TileTracer& tile_tracer() {
+    static TileTracer tracer;
+    return tracer;
+}
+
+// Records the enclosing scope as tile (ti, tj) on the given thread
+class TileTraceScope {
+public:
+    TileTraceScope(int ti, int tj, int thread) : ti(ti), tj(tj), thread(thread), start(tile_tracer().now()) {}
+    ~TileTraceScope() { tile_tracer().record(thread, ti, tj, start, tile_tracer().now()); }
+
+private:
+    int ti, tj, thread;
+    double start;
+};
+
+#define GPSA_TRACE_BEGIN() tile_tracer().begin(omp_get_max_threads())
+#define GPSA_TRACE_TILE(ti, tj, thread) TileTraceScope gpsa_trace_scope(ti, tj, thread)
+#define GPSA_TRACE_END() tile_tracer().end()
+#define GPSA_TRACE_REPORT(filename) tile_tracer().report(filename)
+#else
+#define GPSA_TRACE_BEGIN() ((void)0)
+#define GPSA_TRACE_TILE(ti, tj, thread) ((void)0)
+#define GPSA_TRACE_END() ((void)0)
+#define GPSA_TRACE_REPORT(filename) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,166 @@
+#include <atomic>
+#include <vector>
+#include <random>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include "numa.hpp"
+
+#ifndef WORK_STEALING
+#define WORK_STEALING
+
+// Chase-Lev work-stealing deque of task indices (Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models"). The owner pushes and pops at the bottom,
+// thieves steal from the top. The capacity is fixed, callers size it for the whole job.
+class WorkStealingDeque {
+    std::atomic<long> top{0}, bottom{0};
+    std::vector<std::atomic<int>> buffer;
+    long mask;
+
+public:
+    explicit WorkStealingDeque(long capacity) {
+        long size = 1;
+        while (size < capacity) size <<= 1;
+        buffer = std::vector<std::atomic<int>>(size);
+        mask = size - 1;
+    }
+
+    // owner only
+    void push(int task) {
+        long b = bottom.load(std::memory_order_relaxed);
+        buffer[b & mask].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // owner only, returns false when empty
+    bool pop(int& task) {
+        long b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        task = buffer[b & mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // last element, race against thieves
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // any thread, returns false when empty or when losing a race
+    bool steal(int& task) {
+        long t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b)
+            return false;
+
+        task = buffer[t & mask].load(std::memory_order_relaxed);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+};
+
+// Runs a grid of n_rows x n_cols tiles on std::threads. Tile (i, j) depends on (i-1, j) and
+// (i, j-1); each tile has an atomic counter of unfinished dependencies and is pushed to the
+// deque of the thread that completes its last dependency. Idle threads steal from random victims.
+// run_tile(i, j, thread_id) does the work.
+// With a layout, worker t is pinned to layout->cpu_of_thread[t], and tile row i belongs to worker
+// i % n_threads, the thread allocate_numa first-touches its row block with (block_rows equal to
+// the tile rows). A ready tile stays with the worker that completed its last dependency when that
+// worker is on the owner's node, otherwise it is handed to the owner through its inbox (the
+// deques only take pushes from their own thread), which the owner moves to its deque before its
+// next pop. Idle workers steal on their own node first, and only then anywhere.
+template <typename F>
+void run_tile_grid(int n_rows, int n_cols, int n_threads, F run_tile, const NumaLayout* layout = nullptr) {
+    int n_tiles = n_rows * n_cols;
+    std::vector<std::atomic<int>> pending(n_tiles);
+    for (int i = 0; i < n_rows; ++i)
+        for (int j = 0; j < n_cols; ++j)
+            pending[i * n_cols + j].store((i > 0) + (j > 0), std::memory_order_relaxed);
+
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+    for (int t = 0; t < n_threads; ++t)
+        deques.emplace_back(new WorkStealingDeque(n_tiles));
+    deques[0]->push(0);
+
+    std::vector<std::mutex> inbox_lock(n_threads);
+    std::vector<std::vector<int>> inbox(n_threads);
+    std::vector<std::atomic<bool>> has_mail(n_threads);
+    std::atomic<int> remaining(n_tiles);
+
+    // victims on the same node as each worker (all workers without a layout)
+    std::vector<std::vector<int>> near(n_threads);
+    for (int t = 0; t < n_threads; ++t)
+        for (int v = 0; v < n_threads; ++v)
+            if (v != t && (!layout || layout->node_of_thread[t] == layout->node_of_thread[v]))
+                near[t].push_back(v);
+
+    auto push_ready = [&](int id, int tile) {
+        int owner = tile / n_cols % n_threads;
+        if (!layout || layout->node_of_thread[owner] == layout->node_of_thread[id]) {
+            deques[id]->push(tile);
+        } else {
+            std::lock_guard<std::mutex> lock(inbox_lock[owner]);
+            inbox[owner].push_back(tile);
+            has_mail[owner].store(true, std::memory_order_release);
+        }
+    };
+
+    auto worker = [&](int id) {
+        std::minstd_rand rng(id + 1);
+        int tile;
+        if (layout)
+            pin_current_thread(layout->cpu_of_thread[id]);
+
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            // handed over tiles first, they are the ones the other node waits for
+            if (has_mail[id].load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(inbox_lock[id]);
+                for (int t: inbox[id])
+                    deques[id]->push(t);
+                inbox[id].clear();
+                has_mail[id].store(false, std::memory_order_relaxed);
+            }
+            if (!deques[id]->pop(tile)) {
+                // one attempt on a node-local victim, then one anywhere
+                bool stolen = !near[id].empty() && deques[near[id][rng() % near[id].size()]]->steal(tile);
+                if (!stolen) {
+                    int victim = rng() % n_threads;
+                    stolen = victim != id && deques[victim]->steal(tile);
+                }
+                if (!stolen) {
+                    std::this_thread::yield();
+                    continue;
+                }
+            }
+
+            int i = tile / n_cols, j = tile % n_cols;
+            run_tile(i, j, id);
+
+            // south first, so east (same rows, warm cache) is popped next
+            if (i + 1 < n_rows && pending[tile + n_cols].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                push_ready(id, tile + n_cols);
+            if (j + 1 < n_cols && pending[tile + 1].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                push_ready(id, tile + 1);
+
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < n_threads; ++t)
+        threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& th: threads)
+        th.join();
+}
+#endif
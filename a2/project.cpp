@@ -2,11 +2,18 @@
 #include <vector>
 #include <CL/cl.hpp>
 #include <chrono>
+#include <cstring>
+#include <cmath>
+#include <immintrin.h>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
 
 const int matrixSize = 4096;
 const int TILE_SIZE = 32;
 const int COLS_PER_THREAD = 8;
 const int WG_SIZE = 8;
+const int ITERATIONS = 96;
 
 //=================================================================================================================================================
 //==================================== << BASIC UNOPTIMIZED (NATIVE FUNCTIONS) KERNEL >> ==========================================================
@@ -36,7 +43,9 @@ const char *basic = R"(
 //=================================================================================================================================================
 
 const char *op_thread_row = R"(
+    #ifndef COLS_PER_THREAD
     #define COLS_PER_THREAD 8
+    #endif
     __kernel void updateMatrix(__global double* input, __global double* output, const int n, const int iteration) {
         int row = get_global_id(0);
         int startCol = get_global_id(1) * COLS_PER_THREAD;
@@ -62,7 +71,9 @@ const char *op_thread_row = R"(
 //=================================================================================================================================================
 
 const char *opt_local = R"(
+    #ifndef TILE_SIZE
     #define TILE_SIZE 32
+    #endif
     __kernel void updateMatrix(__global double* input, __global double* output, const int n, const int iteration) {
         __local double localMem[TILE_SIZE * TILE_SIZE];
 
@@ -96,6 +107,79 @@ const char *opt_local = R"(
 )";
 
 
+//=================================================================================================================================================
+//=========================================== << FUSED LOCAL MEMORY KERNEL >> =====================================================================
+//=================================================================================================================================================
+
+// steps (at most FUSE_DEPTH) iterations per launch, from iteration on. A work-group of TILE_SIZE x
+// TILE_SIZE work-items owns a tile of as many cells and loads it into local memory with a halo: one
+// row and column above and left per odd iteration of the launch (they read up and left) and one
+// below and right per even one. Every step computes the part of the local region whose neighbours
+// are still valid, which shrinks by one on the side the step reads from (not at the grid boundary,
+// which never changes), so after the last step the tile itself is left and goes to output.
+// Global memory is read and written once per launch instead of once per iteration.
+const char *opt_local_fused = R"(
+    #ifndef TILE_SIZE
+    #define TILE_SIZE 16
+    #endif
+    #ifndef FUSE_DEPTH
+    #define FUSE_DEPTH 8
+    #endif
+    #define LOCAL_EDGE (TILE_SIZE + FUSE_DEPTH)
+    __kernel void updateMatrix(__global double* input, __global double* output, const int n, const int iteration, const int steps) {
+        __local double bufA[LOCAL_EDGE * LOCAL_EDGE];
+        __local double bufB[LOCAL_EDGE * LOCAL_EDGE];
+
+        int r0 = get_group_id(0) * TILE_SIZE, r1 = min(n, r0 + TILE_SIZE);
+        int c0 = get_group_id(1) * TILE_SIZE, c1 = min(n, c0 + TILE_SIZE);
+        int odd = (steps + (iteration % 2)) / 2, even = steps - odd;
+        int R0 = max(0, r0 - odd), R1 = min(n, r1 + even);
+        int C0 = max(0, c0 - odd), C1 = min(n, c1 + even);
+        int W = C1 - C0;
+        int lid = get_local_id(0) * TILE_SIZE + get_local_id(1);
+
+        // tile and halo into both buffers, the boundary cells are read from either
+        for (int k = lid; k < (R1 - R0) * W; k += TILE_SIZE * TILE_SIZE) {
+            int li = k / W, lj = k % W;
+            double value = input[(R0 + li) * n + C0 + lj];
+            bufA[li * LOCAL_EDGE + lj] = value;
+            bufB[li * LOCAL_EDGE + lj] = value;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        // valid region [top, bottom) x [left, right)
+        __local double* in = bufA;
+        __local double* out = bufB;
+        int top = R0, bottom = R1, left = C0, right = C1;
+        for (int s = 0; s < steps; ++s) {
+            int d = ((iteration + s) % 2 == 0) ? 1 : -1;
+            if (d < 0) {
+                if (top > 0) top++;
+                if (left > 0) left++;
+            } else {
+                if (bottom < n) bottom--;
+                if (right < n) right--;
+            }
+            int iFirst = max(top, 1), rows = max(0, min(bottom, n - 1) - iFirst);
+            int jFirst = max(left, 1), cols = max(0, min(right, n - 1) - jFirst);
+            for (int k = lid; k < rows * cols; k += TILE_SIZE * TILE_SIZE) {
+                int i = iFirst + k / cols - R0, j = jFirst + k % cols - C0;
+                out[i * LOCAL_EDGE + j] = (in[(i + d) * LOCAL_EDGE + j + d] + in[i * LOCAL_EDGE + j + d] + in[(i + d) * LOCAL_EDGE + j]) / 3.0;
+            }
+            barrier(CLK_LOCAL_MEM_FENCE);
+            __local double* t = in;
+            in = out;
+            out = t;
+        }
+
+        int i = r0 + get_local_id(0), j = c0 + get_local_id(1);
+        if (i < r1 && j < c1) {
+            output[i * n + j] = in[(i - R0) * LOCAL_EDGE + j - C0];
+        }
+    }
+)";
+
+
 //================================================================================================================
 //================================= << HELPERS >> ================================================================
 //================================================================================================================
@@ -144,7 +228,7 @@ size_t roundUp(int groupSize, int globalSize) {
 void updateMatrix(double** matrix) {
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    for (int iter = 1; iter <= 96; ++iter) {
+    for (int iter = 1; iter <= ITERATIONS; ++iter) {
         double** tempMatrix = new double*[matrixSize];
         for (int i = 0; i < matrixSize; ++i) {
             tempMatrix[i] = new double[matrixSize];
@@ -184,88 +268,646 @@ void updateMatrix(double** matrix) {
 void displayHelp(const char* programName) {
     std::cout << "Usage: " << programName << " [options]\n"
               << "Options:\n"
-              << "  --mode=<number>  Set the mode of the program (valid modes are 0 to 4). Default is 4.\n"
+              << "  --mode=<number>  Set the mode of the program (valid modes are 0 to 7). Default is 4.\n"
+              << "                   0 sequential, 1-4 OpenCL kernels, 5 multithreaded SIMD CPU engine,\n"
+              << "                   6 temporally blocked CPU engine (5 and 6 need no OpenCL),\n"
+              << "                   7 OpenCL local memory kernel with a halo, --depth iterations per launch.\n"
+              << "  --depth=<number> Modes 6 and 7: iterations fused per tile. Default is 8, in mode 7 the tuned\n"
+              << "                   depth when there is one; a given depth is kept and must fit local memory.\n"
+              << "  --block=<number> Mode 6: tile edge in cells. Default is 128.\n"
               << "  --help           Display this help message.\n"
-              << "  --print          Set the program to print result matrices. Sending output to file recommended.\n";
+              << "  --print          Set the program to print result matrices. Sending output to file recommended.\n"
+              << "  --device=<name>  OpenCL device: gpu, cpu (e.g. POCL), auto (a GPU if any) or a part of its name.\n"
+              << "                   Default is auto, without any device modes 1-4 and 7 run the CPU engine.\n"
+              << "  --list-devices   List the OpenCL devices.\n"
+              << "  --autotune       Time the kernel variants of the mode on the device and keep the fastest in\n"
+              << "                   autotune-cache.txt, which later runs use. With --depth only the tile size is\n"
+              << "                   tuned and nothing is saved.\n"
+              << "  --pipelined      OpenCL modes: enqueue all iterations without waiting in between, per-iteration\n"
+              << "                   kernel times from OpenCL profiling events.\n"
+              << "  --check          Compare the result bit for bit with the sequential update (modes 1 to 7).\n";
 }
 
 //================================================================================================================
 //================================= << END OF HELPERS >> =========================================================
 //================================================================================================================
 
-int main(int argc, char *argv[]) {
-    int mode = 4;
-    const char *kernelSource;
-    cl::NDRange global, local;
-    bool printMat = false;
+//================================================================================================================
+//================================= << CPU ENGINE >> =============================================================
+//================================================================================================================
 
-    for (int i = 1; i < argc; ++i) {
-        std::string arg(argv[i]);
+// Multithreaded SIMD version of updateMatrix for nodes without a GPU. The grid is flat and
+// contiguous, two buffers are swapped between the iterations (the boundary is never written, so
+// both keep it), and the rows of an iteration are split over the OpenMP threads. Compile with
+// -fopenmp -march=native for the threads and AVX2/AVX-512. The sums are added in the order of
+// updateMatrix and divided by 3.0 (no multiplication by 1/3), so the result is bit for bit the same.
 
-        if (arg == "--help") {
-            displayHelp(argv[0]);
-            return 0;
-        } else if (arg.find("--mode=") == 0) {
-            mode = std::stoi(arg.substr(7));
-            if (mode < 0 || mode > 4) {
-                std::cerr << "Error: Invalid mode number. Valid modes are 0, 1, 2, 3, and 4.\n";
-                std::exit(1);
+// One row of an iteration: out[j] = (p[j+d] + q[j+d] + p[j]) / 3 for first <= j < last, where q is
+// the row itself and p the row above (d = -1, odd iterations) or below (d = +1, even iterations)
+inline void stencilRow(const double* p, const double* q, double* out, int d, int first, int last) {
+    int j = first;
+#if defined(__AVX512F__)
+    const __m512d three = _mm512_set1_pd(3.0);
+    for (; j + 8 <= last; j += 8) {
+        __m512d sum = _mm512_add_pd(_mm512_add_pd(_mm512_loadu_pd(p + j + d), _mm512_loadu_pd(q + j + d)), _mm512_loadu_pd(p + j));
+        _mm512_storeu_pd(out + j, _mm512_div_pd(sum, three));
+    }
+#elif defined(__AVX__)
+    const __m256d three = _mm256_set1_pd(3.0);
+    for (; j + 4 <= last; j += 4) {
+        __m256d sum = _mm256_add_pd(_mm256_add_pd(_mm256_loadu_pd(p + j + d), _mm256_loadu_pd(q + j + d)), _mm256_loadu_pd(p + j));
+        _mm256_storeu_pd(out + j, _mm256_div_pd(sum, three));
+    }
+#endif
+    for (; j < last; ++j) {
+        out[j] = (p[j + d] + q[j + d] + p[j]) / 3.0;
+    }
+}
+
+// Runs all iterations on grid, spare is a second buffer of the same size. The result ends up in
+// grid (the pointers are swapped when the iteration count is odd).
+void updateMatrixCpu(double*& grid, double*& spare) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    const int n = matrixSize;
+
+    std::memcpy(spare, grid, (size_t)n * n * sizeof(double));
+
+    // one parallel region for all iterations, the barrier of the loop separates them
+    #pragma omp parallel
+    {
+        double* src = grid;
+        double* dst = spare;
+        for (int iter = 1; iter <= ITERATIONS; ++iter) {
+            int d = (iter % 2 == 0) ? 1 : -1;
+            #pragma omp for schedule(static)
+            for (int i = 1; i < n - 1; ++i) {
+                stencilRow(src + (size_t)(i + d) * n, src + (size_t)i * n, dst + (size_t)i * n, d, 1, n - 1);
             }
-        } else if (arg == "--print") {
-            printMat = true;
+            std::swap(src, dst);
+        }
+    }
+    if (ITERATIONS % 2 == 1) {
+        std::swap(grid, spare);
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    std::cout << "Update time: " << duration.count() << " milliseconds" << std::endl;
+}
+
+// Temporally blocked version: a time block of depth iterations runs tile by tile, each tile in two
+// small local buffers that stay in cache, so the grid goes through memory once per time block
+// instead of once per iteration. An odd iteration reads up and left, an even one down and right,
+// so a tile is loaded with a halo of one row and column above/left per odd iteration of the block
+// and one below/right per even one. Every step computes the part of the local region whose
+// neighbours are still valid, which shrinks by one on the side the step reads from (cells on the
+// grid boundary never change, so the region does not shrink there). After the block the tile itself
+// is left and goes to the output grid. The halo cells are computed by several tiles, with the same
+// operations in the same order as updateMatrix, so the result is bit for bit the same.
+
+// One tile [r0, r1) x [c0, c1) of the time block starting at iteration iter0, from src to dst.
+// L0 and L1 hold (r1 - r0 + steps) x (c1 - c0 + steps) doubles.
+void blockedTile(const double* src, double* dst, double* L0, double* L1, int iter0, int steps, int r0, int r1, int c0, int c1) {
+    const int n = matrixSize;
+    int odd = (steps + (iter0 % 2)) / 2, even = steps - odd;
+
+    // local region, clipped to the grid
+    int R0 = std::max(0, r0 - odd), R1 = std::min(n, r1 + even);
+    int C0 = std::max(0, c0 - odd), C1 = std::min(n, c1 + even);
+    int W = C1 - C0;
+    for (int i = R0; i < R1; ++i) {
+        std::memcpy(L0 + (size_t)(i - R0) * W, src + (size_t)i * n + C0, W * sizeof(double));
+        std::memcpy(L1 + (size_t)(i - R0) * W, src + (size_t)i * n + C0, W * sizeof(double));
+    }
+
+    // valid region [top, bottom) x [left, right)
+    int top = R0, bottom = R1, left = C0, right = C1;
+    double* in = L0;
+    double* out = L1;
+    for (int iter = iter0; iter < iter0 + steps; ++iter) {
+        int d = (iter % 2 == 0) ? 1 : -1;
+        if (d < 0) {
+            if (top > 0) top++;
+            if (left > 0) left++;
         } else {
-            std::cerr << "Error: Unknown argument '" << arg << "'. Use --help for usage information.\n";
-            std::exit(1);
+            if (bottom < n) bottom--;
+            if (right < n) right--;
         }
-    }                                                                                                            
+        int iFirst = std::max(top, 1), iLast = std::min(bottom, n - 1);
+        int jFirst = std::max(left, 1) - C0, jLast = std::min(right, n - 1) - C0;
+        for (int i = iFirst; i < iLast; ++i) {
+            stencilRow(in + (size_t)(i + d - R0) * W, in + (size_t)(i - R0) * W, out + (size_t)(i - R0) * W, d, jFirst, jLast);
+        }
+        std::swap(in, out);
+    }
+
+    for (int i = r0; i < r1; ++i) {
+        std::memcpy(dst + (size_t)i * n + c0, in + (size_t)(i - R0) * W + (c0 - C0), (c1 - c0) * sizeof(double));
+    }
+}
 
+// Runs all iterations in time blocks of depth iterations on tiles of block x block cells. The
+// result ends up in grid, like updateMatrixCpu.
+void updateMatrixBlocked(double*& grid, double*& spare, int depth, int block) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    const int n = matrixSize;
+    depth = std::min(depth, ITERATIONS);
+    block = std::min(block, n);
+    const int tiles = (n + block - 1) / block;
+    const int timeBlocks = (ITERATIONS + depth - 1) / depth;
+
+    std::memcpy(spare, grid, (size_t)n * n * sizeof(double));
+
+    #pragma omp parallel
+    {
+        // local buffers of this thread, for all tiles and time blocks
+        size_t localSize = (size_t)(block + depth) * (block + depth);
+        double* L0 = new double[localSize];
+        double* L1 = new double[localSize];
+        double* src = grid;
+        double* dst = spare;
+
+        for (int iter0 = 1; iter0 <= ITERATIONS; iter0 += depth) {
+            int steps = std::min(depth, ITERATIONS - iter0 + 1);
+            #pragma omp for collapse(2) schedule(static)
+            for (int ti = 0; ti < tiles; ++ti) {
+                for (int tj = 0; tj < tiles; ++tj) {
+                    blockedTile(src, dst, L0, L1, iter0, steps, ti * block, std::min(n, (ti + 1) * block), tj * block, std::min(n, (tj + 1) * block));
+                }
+            }
+            std::swap(src, dst);
+        }
+
+        delete[] L0;
+        delete[] L1;
+    }
+    if (timeBlocks % 2 == 1) {
+        std::swap(grid, spare);
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    std::cout << "Update time: " << duration.count() << " milliseconds (time blocks of " << depth << " iterations, " << block << "x" << block << " tiles)" << std::endl;
+}
+
+// Function to compare a flat result with the sequential one bit for bit
+bool checkFlatMatrix(double* flatMatrix, double** reference) {
+    long mismatches = 0;
+    double maxDiff = 0.0;
+    for (int i = 0; i < matrixSize; ++i) {
+        for (int j = 0; j < matrixSize; ++j) {
+            if (std::memcmp(&flatMatrix[i * matrixSize + j], &reference[i][j], sizeof(double)) != 0) {
+                mismatches++;
+                maxDiff = std::max(maxDiff, std::fabs(flatMatrix[i * matrixSize + j] - reference[i][j]));
+            }
+        }
+    }
+    if (mismatches == 0) {
+        std::cout << "Check: OK, bit for bit equal to the sequential update" << std::endl;
+    } else {
+        std::cout << "Check: NOT OK, " << mismatches << " cells differ, max difference " << maxDiff << std::endl;
+    }
+    return mismatches == 0;
+}
+
+//================================================================================================================
+//================================= << OPENCL DEVICE SELECTION AND AUTOTUNING >> =================================
+//================================================================================================================
+
+// Tunables of the kernels. The kernels get TILE_SIZE and COLS_PER_THREAD as -D build options, the
+// constants at the top are only the defaults.
+struct KernelConfig {
+    int wgRows = WG_SIZE, wgCols = WG_SIZE;     // work-group size (modes 2 and 4)
+    int tileSize = TILE_SIZE;                   // mode 3, the work-group is tileSize x tileSize
+    int colsPerThread = COLS_PER_THREAD;        // mode 2
+    int fuseDepth = 8;                          // mode 7, iterations per launch
+};
+
+bool isOpenCLMode(int mode) {
+    return (mode >= 1 && mode <= 4) || mode == 7;
+}
+
+// Iterations one launch runs from iteration iter on
+int launchSteps(int mode, const KernelConfig& cfg, int iter) {
+    return mode == 7 ? std::min(cfg.fuseDepth, ITERATIONS - iter + 1) : 1;
+}
+
+const char* tuneCacheFile = "autotune-cache.txt";
+const int tuneIterations = 4;
+
+// Bytes of local memory the fused kernel of mode 7 needs: two buffers of the tile and its halo
+cl_ulong fusedLocalBytes(const KernelConfig& cfg) {
+    return 2 * (cl_ulong)(cfg.tileSize + cfg.fuseDepth) * (cfg.tileSize + cfg.fuseDepth) * sizeof(double);
+}
+
+KernelConfig defaultConfig(int mode) {
+    KernelConfig cfg;
+    if (mode == 2) {
+        cfg.wgRows = cfg.wgCols = 1;
+    }
+    if (mode == 7) {
+        cfg.tileSize = 16;
+    }
+    return cfg;
+}
+
+std::string buildOptions(const KernelConfig& cfg) {
+    return "-D TILE_SIZE=" + std::to_string(cfg.tileSize) + " -D COLS_PER_THREAD=" + std::to_string(cfg.colsPerThread) + " -D FUSE_DEPTH=" + std::to_string(cfg.fuseDepth);
+}
+
+std::string describeConfig(int mode, const KernelConfig& cfg) {
+    std::stringstream ss;
+    if (mode == 2) ss << "COLS_PER_THREAD=" << cfg.colsPerThread << ", ";
+    if (mode == 3) ss << "TILE_SIZE=" << cfg.tileSize;
+    else if (mode == 7) ss << "TILE_SIZE=" << cfg.tileSize << ", FUSE_DEPTH=" << cfg.fuseDepth;
+    else ss << "work-group " << cfg.wgRows << "x" << cfg.wgCols;
+    return ss.str();
+}
+
+// Kernel source and NDRange of a mode
+const char* setupKernel(int mode, const KernelConfig& cfg, cl::NDRange& global, cl::NDRange& local) {
     switch (mode)
     {
     case 1:
         {
-            kernelSource = basic;
             global = cl::NDRange(matrixSize, matrixSize);
             local = cl::NullRange;
-            break;
+            return basic;
         }
     case 2:
         {
-            kernelSource = op_thread_row;
-            size_t globalWorkSize[2] = { matrixSize, (matrixSize + COLS_PER_THREAD - 1) / COLS_PER_THREAD };
-            size_t localWorkSize[2] = { 1, 1 };  
+            size_t globalWorkSize[2] = { roundUp(cfg.wgRows, matrixSize), roundUp(cfg.wgCols, (matrixSize + cfg.colsPerThread - 1) / cfg.colsPerThread) };
             global = cl::NDRange(globalWorkSize[0], globalWorkSize[1]);
-            local = cl::NDRange(localWorkSize[0], localWorkSize[1]);
-            break;
+            local = cl::NDRange(cfg.wgRows, cfg.wgCols);
+            return op_thread_row;
         }
     case 3:
         {
-            kernelSource = opt_local;
-            size_t globalWorkSize[2] = { roundUp(TILE_SIZE, matrixSize), roundUp(TILE_SIZE, matrixSize) };
-            size_t localWorkSize[2] = { TILE_SIZE, TILE_SIZE };
+            size_t globalWorkSize[2] = { roundUp(cfg.tileSize, matrixSize), roundUp(cfg.tileSize, matrixSize) };
             global = cl::NDRange(globalWorkSize[0], globalWorkSize[1]);
-            local = cl::NDRange(localWorkSize[0], localWorkSize[1]);
-            break;
+            local = cl::NDRange(cfg.tileSize, cfg.tileSize);
+            return opt_local;
         }
-    case 4:
+    case 7:
         {
-            kernelSource = basic;
-            size_t localWorkSize[2] = { WG_SIZE, WG_SIZE }; 
-            size_t globalWorkSize[2] = { roundUp(localWorkSize[0], matrixSize), roundUp(localWorkSize[1], matrixSize) };
+            size_t globalWorkSize[2] = { roundUp(cfg.tileSize, matrixSize), roundUp(cfg.tileSize, matrixSize) };
             global = cl::NDRange(globalWorkSize[0], globalWorkSize[1]);
-            local = cl::NDRange(localWorkSize[0], localWorkSize[1]);
-            break;
+            local = cl::NDRange(cfg.tileSize, cfg.tileSize);
+            return opt_local_fused;
         }
     default:
         {
-            kernelSource = basic;
-            size_t localWorkSize[2] = { WG_SIZE, WG_SIZE }; 
-            size_t globalWorkSize[2] = { roundUp(localWorkSize[0], matrixSize), roundUp(localWorkSize[1], matrixSize) };
+            size_t globalWorkSize[2] = { roundUp(cfg.wgRows, matrixSize), roundUp(cfg.wgCols, matrixSize) };
             global = cl::NDRange(globalWorkSize[0], globalWorkSize[1]);
-            local = cl::NDRange(localWorkSize[0], localWorkSize[1]);
-            break;
+            local = cl::NDRange(cfg.wgRows, cfg.wgCols);
+            return basic;
+        }
+    }
+}
+
+// Candidates of the autotuner for a mode, within the work-group and local memory limits of the device.
+// A fixedDepth above 0 (a --depth given for mode 7) is kept instead of tuned.
+std::vector<KernelConfig> tuningGrid(int mode, size_t maxWorkGroup, cl_ulong localMem, int fixedDepth = 0) {
+    std::vector<KernelConfig> grid;
+    KernelConfig cfg = defaultConfig(mode);
+    if (mode == 2) {
+        for (int cols : {1, 2, 4, 8, 16, 32}) {
+            for (auto wg : std::vector<std::pair<int, int>>{{1, 1}, {1, 16}, {1, 64}, {4, 16}, {16, 16}}) {
+                cfg.colsPerThread = cols;
+                cfg.wgRows = wg.first;
+                cfg.wgCols = wg.second;
+                if ((size_t)wg.first * wg.second <= maxWorkGroup) grid.push_back(cfg);
+            }
         }
-    }                                                                                                                   
-    
+    } else if (mode == 3) {
+        for (int tile : {8, 16, 32}) {
+            cfg.tileSize = tile;
+            if ((size_t)tile * tile <= maxWorkGroup) grid.push_back(cfg);
+        }
+    } else if (mode == 7) {
+        std::vector<int> depths = fixedDepth > 0 ? std::vector<int>{fixedDepth} : std::vector<int>{2, 4, 8, 16};
+        for (int tile : {8, 16, 32}) {
+            for (int depth : depths) {
+                cfg.tileSize = tile;
+                cfg.fuseDepth = depth;
+                if ((size_t)tile * tile <= maxWorkGroup && fusedLocalBytes(cfg) <= localMem) grid.push_back(cfg);
+            }
+        }
+    } else if (mode == 4) {
+        for (int rows : {1, 4, 8, 16, 32}) {
+            for (int cols : {4, 8, 16, 32, 64}) {
+                cfg.wgRows = rows;
+                cfg.wgCols = cols;
+                if ((size_t)rows * cols <= maxWorkGroup) grid.push_back(cfg);
+            }
+        }
+    }
+    return grid;
+}
+
+// Picks the OpenCL device: "gpu", "cpu" (a CPU implementation such as POCL), "auto" (a GPU if there
+// is one, else any device) or a part of the device name. False when there is no such device.
+bool selectDevice(const std::string& want, cl::Device& device) {
+    std::vector<cl::Platform> platforms;
+    cl::Platform::get(&platforms);
+
+    std::vector<cl::Device> all;
+    for (auto& platform : platforms) {
+        std::vector<cl::Device> devices;
+        platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+        all.insert(all.end(), devices.begin(), devices.end());
+    }
+
+    auto pick = [&](auto matches) {
+        for (auto& d : all) {
+            if (matches(d)) {
+                device = d;
+                return true;
+            }
+        }
+        return false;
+    };
+    auto isType = [](cl_device_type type) {
+        return [type](const cl::Device& d) { return (d.getInfo<CL_DEVICE_TYPE>() & type) != 0; };
+    };
+
+    if (want == "gpu") return pick(isType(CL_DEVICE_TYPE_GPU));
+    if (want == "cpu") return pick(isType(CL_DEVICE_TYPE_CPU));
+    if (want == "auto") return pick(isType(CL_DEVICE_TYPE_GPU)) || pick([](const cl::Device&) { return true; });
+    return pick([&](const cl::Device& d) { return d.getInfo<CL_DEVICE_NAME>().find(want) != std::string::npos; });
+}
+
+// Function to list the OpenCL devices
+void listDevices() {
+    std::vector<cl::Platform> platforms;
+    cl::Platform::get(&platforms);
+    if (platforms.empty()) {
+        std::cout << "No OpenCL platforms." << std::endl;
+    }
+    for (auto& platform : platforms) {
+        std::vector<cl::Device> devices;
+        platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+        for (auto& d : devices) {
+            std::cout << platform.getInfo<CL_PLATFORM_NAME>() << ": " << d.getInfo<CL_DEVICE_NAME>()
+                      << ((d.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_GPU) ? " (GPU)" : (d.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU) ? " (CPU)" : "") << std::endl;
+        }
+    }
+}
+
+// Identifies a device in the cache (name and driver, retuned after a driver update)
+std::string deviceKey(const cl::Device& device) {
+    return device.getInfo<CL_DEVICE_NAME>() + " / " + device.getInfo<CL_DRIVER_VERSION>();
+}
+
+// Copies the fields the autotuner varies in a mode, fuseDepth only unless keepDepth
+void copyTunedFields(int mode, const KernelConfig& from, KernelConfig& to, bool keepDepth) {
+    if (mode == 2 || mode == 4) {
+        to.wgRows = from.wgRows;
+        to.wgCols = from.wgCols;
+    }
+    if (mode == 2) to.colsPerThread = from.colsPerThread;
+    if (mode == 3 || mode == 7) to.tileSize = from.tileSize;
+    if (mode == 7 && !keepDepth) to.fuseDepth = from.fuseDepth;
+}
+
+// Cache lines: <mode> <wgRows> <wgCols> <tileSize> <colsPerThread> <fuseDepth> <ms> <device key>
+bool loadTunedConfig(const std::string& key, int mode, KernelConfig& cfg, bool keepDepth) {
+    std::ifstream in(tuneCacheFile);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        int m;
+        KernelConfig c;
+        double ms;
+        std::string k;
+        if (ss >> m >> c.wgRows >> c.wgCols >> c.tileSize >> c.colsPerThread >> c.fuseDepth >> ms && std::getline(ss >> std::ws, k) && m == mode && k == key) {
+            copyTunedFields(mode, c, cfg, keepDepth);
+            return true;
+        }
+    }
+    return false;
+}
+
+void saveTunedConfig(const std::string& key, int mode, const KernelConfig& cfg, double ms) {
+    std::vector<std::string> lines;
+    std::ifstream in(tuneCacheFile);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        int m;
+        KernelConfig c;
+        double oldMs;
+        std::string k;
+        ss >> m >> c.wgRows >> c.wgCols >> c.tileSize >> c.colsPerThread >> c.fuseDepth >> oldMs;
+        std::getline(ss >> std::ws, k);
+        if (!(m == mode && k == key)) lines.push_back(line);
+    }
+    in.close();
+
+    std::ofstream out(tuneCacheFile, std::ofstream::trunc);
+    for (auto& l : lines) out << l << "\n";
+    out << mode << " " << cfg.wgRows << " " << cfg.wgCols << " " << cfg.tileSize << " " << cfg.colsPerThread << " " << cfg.fuseDepth << " " << ms << " " << key << "\n";
+}
+
+// Builds the kernels of a mode for cfg. False (with the build log when verbose) if they do not build.
+bool buildProgram(const cl::Context& context, const cl::Device& device, const char* source, const KernelConfig& cfg, cl::Program& program, bool verbose) {
+    cl::Program::Sources sources;
+    sources.push_back({source, strlen(source)});
+    program = cl::Program(context, sources);
+    std::string options = buildOptions(cfg);
+    if (program.build({device}, options.c_str()) != CL_SUCCESS) {
+        if (verbose) std::cout << " Error building: " << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device) << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Times tuneIterations launches of every candidate of the grid and returns the fastest. The
+// buffers are overwritten.
+KernelConfig autotune(int mode, int fixedDepth, const cl::Context& context, const cl::Device& device, cl::CommandQueue& queue, cl::Buffer& bufIn, cl::Buffer& bufOut, double& bestMs) {
+    size_t maxWorkGroup = 0;
+    cl_ulong localMem = 0;
+    device.getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, &maxWorkGroup);
+    device.getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &localMem);
+    KernelConfig best = defaultConfig(mode);
+    bestMs = -1;
+
+    for (const KernelConfig& cfg : tuningGrid(mode, maxWorkGroup, localMem, fixedDepth)) {
+        cl::Program program;
+        cl::NDRange global, local;
+        const char* source = setupKernel(mode, cfg, global, local);
+        if (!buildProgram(context, device, source, cfg, program, false)) continue;
+        cl::Kernel kernel(program, "updateMatrix");
+        size_t groupSize = (mode == 3 || mode == 7) ? (size_t)cfg.tileSize * cfg.tileSize : (size_t)cfg.wgRows * cfg.wgCols;
+        if (kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device) < groupSize) continue;
+
+        // one untimed launch, then the timed ones
+        bool ok = true;
+        double ms = 0;
+        int steps = launchSteps(mode, cfg, 1);
+        for (int launch = 0; launch <= tuneIterations && ok; ++launch) {
+            auto start_time = std::chrono::high_resolution_clock::now();
+            kernel.setArg(0, bufIn);
+            kernel.setArg(1, bufOut);
+            kernel.setArg(2, matrixSize);
+            kernel.setArg(3, launch * steps + 1);
+            if (mode == 7) kernel.setArg(4, steps);
+            ok = queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local) == CL_SUCCESS && queue.finish() == CL_SUCCESS;
+            if (launch > 0) ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_time).count();
+            std::swap(bufIn, bufOut);
+        }
+        if (!ok) continue;
+
+        ms /= tuneIterations * steps;
+        std::cout << "  " << describeConfig(mode, cfg) << ": " << ms << " ms per iteration" << std::endl;
+        if (bestMs < 0 || ms < bestMs) {
+            best = cfg;
+            bestMs = ms;
+        }
+    }
+    return best;
+}
+
+//================================================================================================================
+//================================= << PIPELINED OPENCL ITERATIONS >> ============================================
+//================================================================================================================
+
+// All iterations enqueued back to back on the in-order queue, with one synchronization at the read
+// back. Two kernel objects are bound once to the two directions of the ping-pong: the first one
+// reads bufIn and writes bufOut and runs the odd iterations, the second one the even iterations the
+// other way round (the kernels only use the parity of the iteration). The fused kernel of mode 7
+// runs several iterations per launch, so its first iteration and step count are set per launch
+// (scalar arguments are captured at enqueue, no sync needed). The queue has to be created
+// with CL_QUEUE_PROFILING_ENABLE: the time of every launch comes from its event, and the gaps
+// between the end of one kernel and the start of the next show the launch overhead left.
+void updateMatrixPipelined(int mode, const KernelConfig& cfg, const cl::Program& program, cl::CommandQueue& queue, cl::Buffer& bufIn, cl::Buffer& bufOut, const cl::NDRange& global, const cl::NDRange& local, double* flatMatrix) {
+    cl::Kernel forward(program, "updateMatrix");
+    cl::Kernel backward(program, "updateMatrix");
+    forward.setArg(0, bufIn);
+    forward.setArg(1, bufOut);
+    forward.setArg(2, matrixSize);
+    forward.setArg(3, 1);
+    backward.setArg(0, bufOut);
+    backward.setArg(1, bufIn);
+    backward.setArg(2, matrixSize);
+    backward.setArg(3, 2);
+
+    std::vector<cl::Event> events;
+    events.reserve(ITERATIONS);
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (int iter = 1; iter <= ITERATIONS; ) {
+        cl::Kernel& kernel = events.size() % 2 == 0 ? forward : backward;
+        int steps = launchSteps(mode, cfg, iter);
+        if (mode == 7) {
+            kernel.setArg(3, iter);
+            kernel.setArg(4, steps);
+        }
+        events.emplace_back();
+        cl_int err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, nullptr, &events.back());
+        if (err != CL_SUCCESS) {
+            std::cerr << "Error: Kernel launch failed (" << err << ").\n";
+            std::exit(1);
+        }
+        iter += steps;
+    }
+    int launches = events.size();
+    queue.enqueueReadBuffer(launches % 2 == 0 ? bufIn : bufOut, CL_TRUE, 0, matrixSize * matrixSize * sizeof(double), flatMatrix);
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    std::cout << "Update time: " << duration.count() << " milliseconds" << std::endl;
+
+    // device side, in ms
+    double total = 0.0, minTime = 0.0, maxTime = 0.0, gaps = 0.0;
+    cl_ulong previousEnd = 0;
+    for (int launch = 0; launch < launches; ++launch) {
+        cl_ulong start = events[launch].getProfilingInfo<CL_PROFILING_COMMAND_START>();
+        cl_ulong end = events[launch].getProfilingInfo<CL_PROFILING_COMMAND_END>();
+        double ms = (end - start) * 1e-6;
+        total += ms;
+        minTime = (launch == 0) ? ms : std::min(minTime, ms);
+        maxTime = std::max(maxTime, ms);
+        if (launch > 0 && start > previousEnd) {
+            gaps += (start - previousEnd) * 1e-6;
+        }
+        previousEnd = end;
+    }
+    std::cout << "Kernel time: " << total << " milliseconds in " << launches << " launches, per launch mean " << total / launches << ", min " << minTime << ", max " << maxTime
+              << ", idle between launches " << gaps << " milliseconds" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int mode = 4;
+    const char *kernelSource;
+    cl::NDRange global, local;
+    bool printMat = false;
+    bool check = false;
+    std::string deviceName = "auto";    // OpenCL device: gpu, cpu, auto or a part of its name
+    bool listOnly = false;
+    bool tune = false;
+    bool pipelined = false;             // OpenCL modes: all iterations enqueued at once, timed by profiling events
+    int depth = 8;                      // modes 6 and 7: iterations per time block / launch
+    bool depthGiven = false;
+    int block = 128;                    // mode 6: tile edge
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+
+        if (arg == "--help") {
+            displayHelp(argv[0]);
+            return 0;
+        } else if (arg.find("--mode=") == 0) {
+            mode = std::stoi(arg.substr(7));
+            if (mode < 0 || mode > 7) {
+                std::cerr << "Error: Invalid mode number. Valid modes are 0, 1, 2, 3, 4, 5, 6 and 7.\n";
+                std::exit(1);
+            }
+        } else if (arg == "--print") {
+            printMat = true;
+        } else if (arg == "--check") {
+            check = true;
+        } else if (arg.find("--device=") == 0) {
+            deviceName = arg.substr(9);
+        } else if (arg == "--list-devices") {
+            listOnly = true;
+        } else if (arg == "--autotune") {
+            tune = true;
+        } else if (arg == "--pipelined") {
+            pipelined = true;
+        } else if (arg.find("--depth=") == 0) {
+            depth = std::stoi(arg.substr(8));
+            depthGiven = true;
+            if (depth < 1) {
+                std::cerr << "Error: The time block depth must be at least 1.\n";
+                std::exit(1);
+            }
+        } else if (arg.find("--block=") == 0) {
+            block = std::stoi(arg.substr(8));
+            if (block < 1) {
+                std::cerr << "Error: The tile edge must be at least 1.\n";
+                std::exit(1);
+            }
+        } else {
+            std::cerr << "Error: Unknown argument '" << arg << "'. Use --help for usage information.\n";
+            std::exit(1);
+        }
+    }                                                                                                            
+
+    // pick the OpenCL device, without one the OpenCL modes run on the CPU engine
+    cl::Device device;
+    if (listOnly) {
+        listDevices();
+        return 0;
+    }
+    if (isOpenCLMode(mode) && !selectDevice(deviceName, device)) {
+        std::cerr << "No OpenCL device for --device=" << deviceName << ", falling back to the CPU engine (mode 5).\n";
+        mode = 5;
+    }
+
     // Initialize the matrix
     double** matrix = new double*[matrixSize];
     for (int i = 0; i < matrixSize; ++i) {
@@ -281,65 +923,125 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    // OpenCL setup
-    std::vector<cl::Platform> platforms;
-    cl::Platform::get(&platforms);
-    auto platform = platforms.front();
-    std::vector<cl::Device> devices;
-    platform.getDevices(CL_DEVICE_TYPE_GPU, &devices);
-    auto device = devices.front();
-    cl::Context context(device);
-    cl::CommandQueue queue(context, device);
-    cl::Program::Sources sources;
-
-    sources.push_back({kernelSource, strlen(kernelSource)});
-
-    cl::Program program(context, sources);
-    if (program.build({device}) != CL_SUCCESS) {
-        std::cout << " Error building: " << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device) << "\n";
-        exit(1);
-    }
-
-    // Allocate memory for matrices in OpenCL
-    cl::Buffer bufIn(context, CL_MEM_READ_WRITE, matrixSize * matrixSize * sizeof(double));
-    cl::Buffer bufOut(context, CL_MEM_READ_WRITE, matrixSize * matrixSize * sizeof(double));
-    queue.enqueueWriteBuffer(bufIn, CL_TRUE, 0, matrixSize * matrixSize * sizeof(double), flatMatrix);
-
-    // Execute the kernel
-    cl::Kernel kernel(program, "updateMatrix");
-    
     if (mode == 0) {                    // sequential
         updateMatrix(matrix);
 
         if (printMat)
             printMatrix(matrix);
-    } else {                            // parallel
-        auto start_time = std::chrono::high_resolution_clock::now();
+    } else if (mode == 5) {             // multithreaded SIMD CPU engine, no OpenCL needed
+        double* spare = new double[matrixSize * matrixSize];
+        updateMatrixCpu(flatMatrix, spare);
+        delete[] spare;
 
-        for (int iter = 1; iter <= 96; ++iter) {
-            kernel.setArg(0, bufIn);
-            kernel.setArg(1, bufOut);
-            kernel.setArg(2, matrixSize);
-            kernel.setArg(3, iter);
+        if (printMat)
+            printFlatMatrix(flatMatrix);
+    } else if (mode == 6) {             // temporally blocked CPU engine
+        double* spare = new double[matrixSize * matrixSize];
+        updateMatrixBlocked(flatMatrix, spare, depth, block);
+        delete[] spare;
 
-            queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local);
+        if (printMat)
+            printFlatMatrix(flatMatrix);
+    } else {                            // parallel
+        // OpenCL setup
+        cl::Context context(device);
+        cl::CommandQueue queue(context, device, pipelined ? CL_QUEUE_PROFILING_ENABLE : 0);
+        std::cout << "Device: " << device.getInfo<CL_DEVICE_NAME>() << std::endl;
 
-            queue.finish();
+        // Allocate memory for matrices in OpenCL
+        cl::Buffer bufIn(context, CL_MEM_READ_WRITE, matrixSize * matrixSize * sizeof(double));
+        cl::Buffer bufOut(context, CL_MEM_READ_WRITE, matrixSize * matrixSize * sizeof(double));
+        queue.enqueueWriteBuffer(bufIn, CL_TRUE, 0, matrixSize * matrixSize * sizeof(double), flatMatrix);
 
-            // Swap buffers
-            std::swap(bufIn, bufOut);
+        // Kernel parameters: tuned now, from the cache of an earlier run, or the defaults
+        // (a --depth given for mode 7 is kept, only the tile size is tuned or taken from the cache)
+        KernelConfig cfg = defaultConfig(mode);
+        cfg.fuseDepth = std::min(depth, ITERATIONS);
+        int fixedDepth = depthGiven ? cfg.fuseDepth : 0;
+        std::string key = deviceKey(device);
+        if (tune && tuningGrid(mode, SIZE_MAX, ~(cl_ulong)0, fixedDepth).empty()) {
+            std::cout << "Nothing to tune in mode " << mode << "." << std::endl;
+        } else if (tune) {
+            std::cout << "Autotuning mode " << mode << ":" << std::endl;
+            double ms;
+            KernelConfig best = autotune(mode, fixedDepth, context, device, queue, bufIn, bufOut, ms);
+            copyTunedFields(mode, best, cfg, false);
+            if (ms >= 0 && depthGiven) {
+                // only the tile size was searched, caching it would pass the fixed depth off as tuned
+                std::cout << "Best: " << describeConfig(mode, cfg) << ", not saved (--depth fixed the depth)" << std::endl;
+            } else if (ms >= 0) {
+                saveTunedConfig(key, mode, cfg, ms);
+                std::cout << "Best: " << describeConfig(mode, cfg) << ", saved to " << tuneCacheFile << std::endl;
+            }
+            queue.enqueueWriteBuffer(bufIn, CL_TRUE, 0, matrixSize * matrixSize * sizeof(double), flatMatrix);
+        } else if (loadTunedConfig(key, mode, cfg, depthGiven)) {
+            std::cout << "Tuned: " << describeConfig(mode, cfg) << " (from " << tuneCacheFile << ")" << std::endl;
+        }
+        if (mode == 7) {
+            cl_ulong localMem = 0;
+            device.getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &localMem);
+            if (fusedLocalBytes(cfg) > localMem) {
+                std::cerr << "Error: " << describeConfig(mode, cfg) << " needs " << fusedLocalBytes(cfg) << " bytes of local memory, the device has "
+                          << localMem << ". Use a smaller --depth.\n";
+                std::exit(1);
+            }
+        }
+        kernelSource = setupKernel(mode, cfg, global, local);
+
+        cl::Program program;
+        if (!buildProgram(context, device, kernelSource, cfg, program, true)) {
+            exit(1);
         }
-        queue.enqueueReadBuffer(bufIn, CL_TRUE, 0, matrixSize * matrixSize * sizeof(double), flatMatrix);
 
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        if (pipelined) {
+            updateMatrixPipelined(mode, cfg, program, queue, bufIn, bufOut, global, local, flatMatrix);
+
+            if (printMat)
+                printFlatMatrix(flatMatrix);
+        } else {
+            // Execute the kernel
+            cl::Kernel kernel(program, "updateMatrix");
 
-        std::cout << "Update time: " << duration.count() << " milliseconds" << std::endl;
+            auto start_time = std::chrono::high_resolution_clock::now();
 
-        if(printMat)
-            printFlatMatrix(flatMatrix);
+            for (int iter = 1, steps = 1; iter <= ITERATIONS; iter += steps) {
+                steps = launchSteps(mode, cfg, iter);
+                kernel.setArg(0, bufIn);
+                kernel.setArg(1, bufOut);
+                kernel.setArg(2, matrixSize);
+                kernel.setArg(3, iter);
+                if (mode == 7) {
+                    kernel.setArg(4, steps);
+                }
+
+                cl_int err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local);
+                if (err != CL_SUCCESS) {
+                    std::cerr << "Error: Kernel launch failed (" << err << ").\n";
+                    std::exit(1);
+                }
+
+                queue.finish();
+
+                // Swap buffers
+                std::swap(bufIn, bufOut);
+            }
+            queue.enqueueReadBuffer(bufIn, CL_TRUE, 0, matrixSize * matrixSize * sizeof(double), flatMatrix);
+
+            auto end_time = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+            std::cout << "Update time: " << duration.count() << " milliseconds" << std::endl;
+
+            if(printMat)
+                printFlatMatrix(flatMatrix);
+        }
     }
 
+    // compare with the sequential update
+    if (check && mode != 0) {
+        updateMatrix(matrix);
+        checkFlatMatrix(flatMatrix, matrix);
+    }
 
     // Cleanup
     for (int i = 0; i < matrixSize; ++i) {